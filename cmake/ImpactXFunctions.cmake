@@ -260,6 +260,10 @@ function(impactx_set_binary_name)
             set_property(TARGET ${tgt} APPEND_STRING PROPERTY OUTPUT_NAME ".SP")
         endif()
 
+        if(NOT ImpactX_PARTICLE_PRECISION STREQUAL ImpactX_PRECISION)
+            set_property(TARGET ${tgt} APPEND_STRING PROPERTY OUTPUT_NAME ".PSP")
+        endif()
+
         #if(ImpactX_ASCENT)
         #    set_property(TARGET ${tgt} APPEND_STRING PROPERTY OUTPUT_NAME ".ASCENT")
         #endif()
@@ -393,6 +397,7 @@ function(impactx_print_summary)
     message("    APP: ${ImpactX_APP}")
     #message("    ASCENT: ${ImpactX_ASCENT}")
     message("    COMPUTE: ${ImpactX_COMPUTE}")
+    message("    FFT: ${ImpactX_FFT}")
     message("    IPO/LTO: ${ImpactX_IPO}")
     message("    LIB: ${ImpactX_LIB}${LIB_TYPE}")
     message("    MPI: ${ImpactX_MPI}")
@@ -400,6 +405,7 @@ function(impactx_print_summary)
         message("    MPI (thread multiple): ${ImpactX_MPI_THREAD_MULTIPLE}")
     endif()
     message("    PRECISION: ${ImpactX_PRECISION}")
+    message("    PARTICLE PRECISION: ${ImpactX_PARTICLE_PRECISION}")
     message("    PYTHON: ${ImpactX_PYTHON}")
     message("    OPENPMD: ${ImpactX_OPENPMD}")
     #message("    SENSEI: ${ImpactX_SENSEI}")
@@ -0,0 +1,68 @@
+# FFTW3 for the FFT-based Poisson solver of the space charge mesh
+#
+# The Poisson solve runs on the host, so GPU backends are not supported yet.
+if(ImpactX_FFT)
+    if(NOT ImpactX_COMPUTE STREQUAL NOACC AND NOT ImpactX_COMPUTE STREQUAL OMP)
+        message(FATAL_ERROR "ImpactX_FFT is only supported with "
+                            "ImpactX_COMPUTE=NOACC or OMP, but got: ${ImpactX_COMPUTE}")
+    endif()
+
+    # the Autotools install of FFTW ships pkg-config files on Linux & macOS;
+    # the CMake config files of FFTW are only reliable on Windows
+    #   https://github.com/FFTW/fftw3/issues/236
+    if(WIN32)
+        set(ImpactX_FFTW_SEARCH_VALUES PKGCONFIG CMAKE)
+        set(ImpactX_FFTW_SEARCH_DEFAULT CMAKE)
+    else()
+        set(ImpactX_FFTW_SEARCH_VALUES PKGCONFIG CMAKE)
+        set(ImpactX_FFTW_SEARCH_DEFAULT PKGCONFIG)
+    endif()
+    set(ImpactX_FFTW_SEARCH ${ImpactX_FFTW_SEARCH_DEFAULT}
+        CACHE STRING "FFTW search method (PKGCONFIG/CMAKE)")
+    set_property(CACHE ImpactX_FFTW_SEARCH PROPERTY STRINGS ${ImpactX_FFTW_SEARCH_VALUES})
+    if(NOT ImpactX_FFTW_SEARCH IN_LIST ImpactX_FFTW_SEARCH_VALUES)
+        message(FATAL_ERROR "ImpactX_FFTW_SEARCH (${ImpactX_FFTW_SEARCH}) must be one of ${ImpactX_FFTW_SEARCH_VALUES}")
+    endif()
+    mark_as_advanced(ImpactX_FFTW_SEARCH)
+
+    # the FFTs are computed in the floating point precision of the mesh
+    if(ImpactX_PRECISION STREQUAL "DOUBLE")
+        set(HFFTWp "fftw3")
+        set(HFFTWc "FFTW3")
+    else()
+        set(HFFTWp "fftw3f")
+        set(HFFTWc "FFTW3f")
+    endif()
+
+    if(ImpactX_FFTW_SEARCH STREQUAL CMAKE)
+        find_package(${HFFTWc} CONFIG REQUIRED)
+        set(_ImpactX_FFTW_TARGET FFTW3::${HFFTWp})
+    else()
+        find_package(PkgConfig REQUIRED QUIET)
+        pkg_check_modules(${HFFTWp} REQUIRED IMPORTED_TARGET ${HFFTWp})
+        set(_ImpactX_FFTW_TARGET PkgConfig::${HFFTWp})
+    endif()
+    message(STATUS "FFTW: Found ${HFFTWp} via ${ImpactX_FFTW_SEARCH}")
+
+    # MPI builds distribute the FFTs over the ranks with the MPI interface of
+    # FFTW, which is a separate library without its own pkg-config file
+    if(ImpactX_MPI)
+        find_library(ImpactX_FFTW_MPI_LIBRARY
+            NAMES ${HFFTWp}_mpi
+            HINTS ${${HFFTWp}_LIBRARY_DIRS} ${${HFFTWc}_LIBRARY_DIRS})
+        if(NOT ImpactX_FFTW_MPI_LIBRARY)
+            message(FATAL_ERROR "ImpactX_MPI=ON requires the MPI interface of "
+                                "FFTW (lib${HFFTWp}_mpi), but it was not found")
+        endif()
+        mark_as_advanced(ImpactX_FFTW_MPI_LIBRARY)
+        message(STATUS "FFTW: Found ${ImpactX_FFTW_MPI_LIBRARY}")
+    endif()
+
+    # create an IMPORTED target: ImpactX::thirdparty::FFT
+    impactx_make_third_party_includes_system(${_ImpactX_FFTW_TARGET} FFT)
+    if(ImpactX_MPI)
+        target_link_libraries(ImpactX::thirdparty::FFT
+            INTERFACE ${ImpactX_FFTW_MPI_LIBRARY} ${_ImpactX_FFTW_TARGET})
+    endif()
+    unset(_ImpactX_FFTW_TARGET)
+endif(ImpactX_FFT)
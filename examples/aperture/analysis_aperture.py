@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022 ImpactX contributors
+# Authors: Axel Huebl, Chad Mitchell
+# License: BSD-3-Clause-LBNL
+#
+
+import glob
+
+import numpy as np
+import pandas as pd
+
+
+def read_all_files(file_pattern):
+    """Read in all CSV files from each MPI rank (and potentially OpenMP
+    thread). Concatenate into one Pandas dataframe.
+
+    Returns
+    -------
+    pandas.DataFrame
+    """
+    return pd.concat(
+        (
+            pd.read_csv(filename, delimiter=r"\s+")
+            for filename in glob.glob(file_pattern)
+        ),
+        axis=0,
+        ignore_index=True,
+    ).set_index("id")
+
+
+def outside_rectangle(beam, xmax, ymax):
+    """Particles outside of a rectangular aperture"""
+    return (np.abs(beam["x"]) > xmax) | (np.abs(beam["y"]) > ymax)
+
+
+def outside_ellipse(beam, xmax, ymax):
+    """Particles outside of an elliptical aperture"""
+    return (beam["x"] / xmax) ** 2 + (beam["y"] / ymax) ** 2 > 1.0
+
+
+# lattice parameters of the example
+pipe_r = 2.5e-3  # m
+collimator_xmax = 1.5e-3  # m
+collimator_ymax = 1.0e-3  # m
+collimator_s = 0.5  # m
+
+# initial/final beam and lost particles on all ranks
+initial = read_all_files("diags/beam_000000.*")
+collimated = read_all_files("diags/beam_000002.*")
+final = read_all_files("diags/beam_final.*")
+lost = read_all_files("diags/particles_lost.*")
+
+num_particles = 10000
+print(f"Lost particles: {len(lost)} of {num_particles}")
+assert num_particles == len(initial)
+
+# particles are either lost or survive, each exactly once
+assert 0 < len(lost) < num_particles
+assert len(final) + len(lost) == num_particles
+assert lost.index.is_unique
+assert final.index.intersection(lost.index).empty
+assert initial.index.sort_values().equals(final.index.union(lost.index))
+
+# all particles were lost at the end of the first drift or in the collimator
+assert np.allclose(lost["s"], collimator_s, rtol=0.0, atol=1e-12)
+
+# lost particles are outside of the collimator or the beam pipe
+assert np.all(
+    outside_rectangle(lost, collimator_xmax, collimator_ymax)
+    | outside_ellipse(lost, pipe_r, pipe_r)
+)
+
+# after the collimator, all particles are inside both apertures
+assert len(collimated) == len(final)
+assert not np.any(outside_rectangle(collimated, collimator_xmax, collimator_ymax))
+assert not np.any(outside_ellipse(collimated, pipe_r, pipe_r))
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022 ImpactX contributors
+# Authors: Axel Huebl, Chad Mitchell
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import amrex
+from impactx import ImpactX, distribution, elements
+
+sim = ImpactX()
+
+# set numerical parameters and IO control
+sim.set_particle_shape(2)  # B-spline order
+sim.set_space_charge(False)
+# sim.set_diagnostics(False)  # benchmarking
+sim.set_slice_step_diagnostics(True)
+
+# domain decomposition & space charge mesh
+sim.init_grids()
+
+# load a 2 GeV electron beam
+energy_MeV = 2.0e3  # reference energy
+bunch_charge_C = 1.0e-9  # used without space charge
+npart = 10000  # number of macro particles
+
+#   reference particle
+ref = sim.particle_container().ref_particle()
+ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_energy_MeV(energy_MeV)
+
+#   particle bunch
+distr = distribution.Waterbag(
+    sigmaX=1.0e-3,
+    sigmaY=1.0e-3,
+    sigmaT=1.0e-3,
+    sigmaPx=1.0e-5,
+    sigmaPy=1.0e-5,
+    sigmaPt=2.0e-3,
+)
+sim.add_particles(bunch_charge_C, distr, npart)
+
+# global elliptical aperture of the beam pipe
+sim.aperture = elements.Aperture(xmax=2.5e-3, ymax=2.5e-3, shape="elliptical")
+
+# design the accelerator lattice: a rectangular collimator between two drifts
+sim.lattice.extend(
+    [
+        elements.Drift(ds=0.5),
+        elements.Aperture(xmax=1.5e-3, ymax=1.0e-3, shape="rectangular"),
+        elements.Drift(ds=0.5),
+    ]
+)
+
+# run simulation
+sim.evolve()
+
+# clean shutdown
+del sim
+amrex.finalize()
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022 ImpactX contributors
+# Authors: Axel Huebl, Chad Mitchell
+# License: BSD-3-Clause-LBNL
+#
+
+import numpy as np
+import pandas as pd
+from scipy.integrate import solve_ivp
+
+# final rms beam sizes for each splitting order and number of slices
+runs = pd.read_csv("splitting_convergence.txt", delimiter=r"\s+")
+
+# beam parameters of the run script
+current = 100.0  # A
+kin_energy_MeV = 2.0e3
+mass_MeV = 938.27208816
+gamma = 1.0 + kin_energy_MeV / mass_MeV
+bg = np.sqrt(gamma**2 - 1.0)
+I0 = mass_MeV * 1.0e6 / 29.9792458  # characteristic current in A
+perveance = 2.0 * current / (I0 * bg**3)
+sig0 = 1.0e-3  # initial rms size in m, at a waist
+emittance = 1.0e-6  # rms emittance in m
+k = 1.0  # focusing wavenumber in 1/m
+length = 2.0  # channel length in m
+
+
+# the rms envelope equation of a round KV beam in a constant focusing channel:
+#   sig'' = -k^2 sig + eps^2 / sig^3 + K / (4 sig)
+def envelope_equation(s, u):
+    sig, dsig = u
+    return [dsig, -(k**2) * sig + emittance**2 / sig**3 + perveance / (4.0 * sig)]
+
+
+solution = solve_ivp(
+    envelope_equation, (0.0, length), [sig0, 0.0], rtol=1.0e-12, atol=1.0e-16
+)
+sig_ode = solution.y[0][-1]
+print(f"Generalized perveance: {perveance:e}")
+print(f"Final sig_x from the envelope equation: {sig_ode:e}")
+
+# space charge must be significant for this test
+assert sig_ode > 1.01 * sig0
+
+# the relative error must decrease with the order of the splitting
+print("")
+print("order nslice relative_error convergence_rate")
+for order, group in runs.groupby("order"):
+    error = np.abs(group["sig_x"].to_numpy() - sig_ode) / sig_ode
+    nslice = group["nslice"].to_numpy()
+    rates = np.log(error[:-1] / error[1:]) / np.log(nslice[1:] / nslice[:-1])
+    for i in range(len(nslice)):
+        rate = f"{rates[i - 1]:.2f}" if i > 0 else ""
+        print(f"{order} {nslice[i]} {error[i]:e} {rate}")
+
+    # round beam
+    assert np.allclose(group["sig_y"], group["sig_x"], rtol=1.0e-12, atol=0.0)
+    # the error converges with the order of the splitting
+    assert np.allclose(rates, order, rtol=0.15, atol=0.0)
@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022 ImpactX contributors
+# Authors: Axel Huebl, Chad Mitchell
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import amrex
+import numpy as np
+from impactx import ImpactX, elements
+
+# convergence of the splitting of space charge kicks and slice maps:
+# track the envelope of a beam with linear space charge through the
+# constant focusing channel with an increasing number of slices
+current_A = 100.0  # large beam current, so space charge is significant
+orders = [1, 2, 4]
+nslices = [8, 16, 32, 64]
+
+results = []
+for order in orders:
+    for ns in nslices:
+        sim = ImpactX()
+
+        # set numerical parameters and IO control
+        sim.set_particle_shape(2)  # B-spline order
+        sim.set_space_charge(True)
+        sim.set_space_charge_order(order)
+        sim.set_track("envelope")
+        sim.set_diagnostics(False)
+
+        # domain decomposition & space charge mesh
+        sim.init_grids()
+
+        #   reference particle: 2 GeV protons
+        ref = sim.particle_container().ref_particle()
+        ref.set_charge_qe(1.0).set_mass_MeV(938.27208816).set_energy_MeV(2.0e3)
+
+        #   beam envelope, with the parameters of the particle distribution
+        sim.init_envelope(
+            sigmaX=1.0e-3,
+            sigmaY=1.0e-3,
+            sigmaT=3.369701494258956e-4,
+            sigmaPx=1.0e-3,
+            sigmaPy=1.0e-3,
+            sigmaPt=2.9676219145931020e-3,
+            current=current_A,
+        )
+
+        # design the accelerator lattice
+        sim.lattice.append(
+            elements.ConstF(ds=2.0, kx=1.0, ky=1.0, kt=1.0, nslice=ns)
+        )
+
+        # run simulation
+        sim.evolve()
+
+        cm = sim.envelope()
+        results.append([order, ns, np.sqrt(cm[0][0]), np.sqrt(cm[2][2])])
+        del sim
+
+# final rms beam sizes of all runs
+np.savetxt(
+    "splitting_convergence.txt",
+    results,
+    header="order nslice sig_x sig_y",
+    comments="",
+)
+
+# clean shutdown
+amrex.finalize()
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022 ImpactX contributors
+# Authors: Axel Huebl, Chad Mitchell
+# License: BSD-3-Clause-LBNL
+#
+
+import os
+
+import numpy as np
+import pandas as pd
+from scipy.integrate import solve_ivp
+
+# rms sizes and emittances at every slice step
+envelope = pd.read_csv("diags/envelope", delimiter=r"\s+")
+initial = envelope.iloc[0]
+final = envelope.iloc[-1]
+
+# beam parameters of the input file
+current = 1.0e-3  # A
+kin_energy_MeV = 2.5
+mass_MeV = 938.27208816
+gamma = 1.0 + kin_energy_MeV / mass_MeV
+bg = np.sqrt(gamma**2 - 1.0)
+I0 = mass_MeV * 1.0e6 / 29.9792458  # characteristic current in A
+perveance = 2.0 * current / (I0 * bg**3)
+print(f"Generalized perveance: {perveance:e}")
+
+# the emittances are conserved in the linear space charge field
+rtol = 1.0e-8
+print("Emittances:")
+for column in ["emittance_x", "emittance_y", "emittance_t"]:
+    print(f"  {column}: {initial[column]:e} -> {final[column]:e}")
+    assert np.allclose(envelope[column], initial[column], rtol=rtol, atol=0.0)
+
+
+# the rms envelope equations of a KV beam in a drift:
+#   sig_x'' = eps_x^2 / sig_x^3 + K / (2 (sig_x + sig_y))
+def envelope_equations(s, u):
+    sigx, dsigx, sigy, dsigy = u
+    return [
+        dsigx,
+        initial["emittance_x"] ** 2 / sigx**3 + perveance / (2.0 * (sigx + sigy)),
+        dsigy,
+        initial["emittance_y"] ** 2 / sigy**3 + perveance / (2.0 * (sigx + sigy)),
+    ]
+
+
+# the beam has no initial correlation, i.e., it starts at a waist
+solution = solve_ivp(
+    envelope_equations,
+    (0.0, final["s"]),
+    [initial["sig_x"], 0.0, initial["sig_y"], 0.0],
+    t_eval=envelope["s"],
+    rtol=1.0e-10,
+    atol=1.0e-14,
+)
+sigx_ode = solution.y[0]
+sigy_ode = solution.y[2]
+
+print("")
+print("Final Beam:")
+print(f"  sig_x={final['sig_x']:e} (envelope equation: {sigx_ode[-1]:e})")
+print(f"  sig_y={final['sig_y']:e} (envelope equation: {sigy_ode[-1]:e})")
+
+# space charge must be significant for this test
+assert final["sig_x"] > 1.05 * initial["sig_x"]
+
+# second-order splitting of the space charge kicks and the slices
+rtol = 1.0e-5
+assert np.allclose(envelope["sig_x"], sigx_ode, rtol=rtol, atol=0.0)
+assert np.allclose(envelope["sig_y"], sigy_ode, rtol=rtol, atol=0.0)
+
+# with algo.slice_tolerance, the drift is sliced adaptively
+if os.path.exists("diags/slicing"):
+    slicing = pd.read_csv("diags/slicing", delimiter=r"\s+")
+    print("")
+    print("Adaptive slicing:")
+    print(slicing.to_string(index=False))
+    assert slicing["nslice"].sum() == final["step"]
+    assert slicing["nslice"].sum() < 200
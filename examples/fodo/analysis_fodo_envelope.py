@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022 ImpactX contributors
+# Authors: Axel Huebl, Chad Mitchell
+# License: BSD-3-Clause-LBNL
+#
+
+import numpy as np
+import pandas as pd
+
+# rms sizes and emittances at every slice step
+envelope = pd.read_csv("diags/envelope", delimiter=r"\s+")
+initial = envelope.iloc[0]
+final = envelope.iloc[-1]
+
+# compare number of slice steps: 5 elements with 25 slices each
+num_steps = 125
+assert num_steps == final["step"]
+assert num_steps + 1 == len(envelope)
+
+columns = ["sig_x", "sig_y", "sig_t", "emittance_x", "emittance_y", "emittance_t"]
+
+# the envelope has no sampling noise: nominal values follow from the
+# distribution parameters, for a beam that is matched at entry and exit
+# up to the digits of the matched Twiss parameters
+nominal = [
+    7.512149372880258e-005,
+    7.512149372880258e-005,
+    1.0e-003,
+    2.0e-009,
+    2.0e-009,
+    2.0e-006,
+]
+rtol = 1.0e-7
+atol = 0.0
+
+print("Initial Beam:")
+print(initial[columns].to_string())
+assert np.allclose(initial[columns], nominal, rtol=rtol, atol=atol)
+
+print("")
+print("Final Beam:")
+print(final[columns].to_string())
+assert np.allclose(final[columns], nominal, rtol=rtol, atol=atol)
+
+# the emittances are conserved in every slice step
+print("")
+print("Emittances over all slice steps:")
+for column in ["emittance_x", "emittance_y", "emittance_t"]:
+    print(f"  {column}: {envelope[column].min():e} ... {envelope[column].max():e}")
+    assert np.allclose(envelope[column], envelope[column][0], rtol=rtol, atol=atol)
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022 ImpactX contributors
+# Authors: Axel Huebl, Chad Mitchell
+# License: BSD-3-Clause-LBNL
+#
+
+import numpy as np
+import pandas as pd
+
+
+def drift(L):
+    return np.array([[1.0, L], [0.0, 1.0]])
+
+
+def quad(L, k):
+    """thick quadrupole, focusing for k > 0"""
+    if k > 0:
+        w = np.sqrt(k)
+        return np.array(
+            [[np.cos(w * L), np.sin(w * L) / w], [-w * np.sin(w * L), np.cos(w * L)]]
+        )
+    w = np.sqrt(-k)
+    return np.array(
+        [[np.cosh(w * L), np.sinh(w * L) / w], [w * np.sinh(w * L), np.cosh(w * L)]]
+    )
+
+
+def periodic_twiss(M):
+    """beta, alpha and tune of a one-period map with a phase advance below pi"""
+    cosmu = 0.5 * np.trace(M)
+    sinmu = np.sqrt(1.0 - cosmu**2)
+    beta = M[0, 1] / sinmu
+    alpha = 0.5 * (M[0, 0] - M[1, 1]) / sinmu
+    return beta, alpha, np.arccos(cosmu) / (2.0 * np.pi)
+
+
+# lattice functions at every element and slice boundary
+optics = pd.read_csv("diags/lattice_optics", delimiter=r"\s+")
+initial = optics.iloc[0]
+final = optics.iloc[-1]
+
+# compare number of slice steps: 5 elements with 25 slices each
+num_steps = 125
+assert num_steps == final["step"]
+assert num_steps + 1 == len(optics)
+
+# one-period maps of the FODO cell in x and y
+Mx = drift(0.25) @ quad(1.0, -1.0) @ drift(0.5) @ quad(1.0, 1.0) @ drift(0.25)
+My = drift(0.25) @ quad(1.0, 1.0) @ drift(0.5) @ quad(1.0, -1.0) @ drift(0.25)
+beta_x, alpha_x, tune_x = periodic_twiss(Mx)
+beta_y, alpha_y, tune_y = periodic_twiss(My)
+
+columns = ["beta_x", "alpha_x", "beta_y", "alpha_y", "mu_x", "mu_y"]
+rtol = 1.0e-12
+atol = 1.0e-14
+
+print("Initial lattice functions:")
+print(initial[columns].to_string())
+assert np.allclose(
+    initial[columns], [beta_x, alpha_x, beta_y, alpha_y, 0.0, 0.0], rtol=rtol, atol=atol
+)
+
+# the lattice functions are periodic and the phase advance is the tune
+print("")
+print("Final lattice functions:")
+print(final[columns].to_string())
+assert np.allclose(
+    final[columns],
+    [beta_x, alpha_x, beta_y, alpha_y, tune_x, tune_y],
+    rtol=rtol,
+    atol=atol,
+)
+
+# the matched beam of the FODO example has the same Twiss functions,
+# up to the digits of its distribution parameters
+sigx, sigpx, muxpx = 3.9984884770e-5, 2.6623538760e-5, -0.846574929020762
+root = np.sqrt(1.0 - muxpx**2)
+assert np.isclose(initial["beta_x"], sigx / (sigpx * root), rtol=1.0e-9)
+assert np.isclose(initial["alpha_x"], muxpx / root, rtol=1.0e-9)
+
+# no bends: no dispersion; the phase advance increases monotonically
+for column in ["dispersion_x", "dispersion_px", "dispersion_y", "dispersion_py"]:
+    assert np.allclose(optics[column], 0.0, rtol=0.0, atol=atol)
+assert np.all(np.diff(optics["mu_x"]) > 0.0)
+assert np.all(np.diff(optics["mu_y"]) > 0.0)
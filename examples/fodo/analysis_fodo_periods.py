@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022 ImpactX contributors
+# Authors: Axel Huebl, Chad Mitchell
+# License: BSD-3-Clause-LBNL
+#
+
+import glob
+
+import numpy as np
+import pandas as pd
+from scipy.stats import moment
+
+
+def get_moments(beam):
+    """Calculate standard deviations of beam position & momenta
+    and emittance values
+
+    Returns
+    -------
+    sigx, sigy, sigt, emittance_x, emittance_y, emittance_t
+    """
+    sigx = moment(beam["x"], moment=2) ** 0.5  # variance -> std dev.
+    sigpx = moment(beam["px"], moment=2) ** 0.5
+    sigy = moment(beam["y"], moment=2) ** 0.5
+    sigpy = moment(beam["py"], moment=2) ** 0.5
+    sigt = moment(beam["t"], moment=2) ** 0.5
+    sigpt = moment(beam["pt"], moment=2) ** 0.5
+
+    epstrms = beam.cov(ddof=0)
+    emittance_x = (sigx**2 * sigpx**2 - epstrms["x"]["px"] ** 2) ** 0.5
+    emittance_y = (sigy**2 * sigpy**2 - epstrms["y"]["py"] ** 2) ** 0.5
+    emittance_t = (sigt**2 * sigpt**2 - epstrms["t"]["pt"] ** 2) ** 0.5
+
+    return (sigx, sigy, sigt, emittance_x, emittance_y, emittance_t)
+
+
+def read_all_files(file_pattern):
+    """Read in all CSV files from each MPI rank (and potentially OpenMP
+    thread). Concatenate into one Pandas dataframe.
+
+    Returns
+    -------
+    pandas.DataFrame
+    """
+    return pd.concat(
+        (
+            pd.read_csv(filename, delimiter=r"\s+")
+            for filename in glob.glob(file_pattern)
+        ),
+        axis=0,
+        ignore_index=True,
+    ).set_index("id")
+
+
+# tracking parameters set in CMakeLists.txt
+periods = 10
+period_interval = 5
+period_length = 3.0  # m
+
+# initial/final beam on rank zero
+initial = read_all_files("diags/beam_000000.*")
+final = read_all_files("diags/beam_final.*")
+
+# compare number of particles
+num_particles = 10000
+assert num_particles == len(initial)
+assert num_particles == len(final)
+
+# one output per diagnostics period interval, besides the initial beam
+period_files = [f for f in glob.glob("diags/beam_[0-9]*.*") if "beam_000000" not in f]
+print(f"Period diagnostics: {sorted(period_files)}")
+assert len(period_files) == periods // period_interval
+for filename in period_files:
+    assert num_particles == len(read_all_files(filename))
+
+# reference particle after all periods
+ref_final = pd.concat(
+    pd.read_csv(filename, delimiter=r"\s+")
+    for filename in glob.glob("diags/ref_particle_final.*")
+)
+print(f"Final reference particle: s={ref_final['s'].values[0]}")
+assert np.isclose(ref_final["s"].values[0], periods * period_length)
+
+print("Initial Beam:")
+sigx_i, sigy_i, sigt_i, emittance_x_i, emittance_y_i, emittance_t_i = get_moments(
+    initial
+)
+print(f"  sigx={sigx_i:e} sigy={sigy_i:e} sigt={sigt_i:e}")
+print(
+    f"  emittance_x={emittance_x_i:e} emittance_y={emittance_y_i:e} emittance_t={emittance_t_i:e}"
+)
+
+print("")
+print("Final Beam:")
+sigx, sigy, sigt, emittance_x, emittance_y, emittance_t = get_moments(final)
+print(f"  sigx={sigx:e} sigy={sigy:e} sigt={sigt:e}")
+print(
+    f"  emittance_x={emittance_x:e} emittance_y={emittance_y:e} emittance_t={emittance_t:e}"
+)
+
+# the FODO cell is linear and symplectic: the rms emittances are conserved
+rtol = 1.0e-4  # ASCII output and particle precision
+print(f"  emittance rtol={rtol}")
+assert np.allclose(
+    [emittance_x, emittance_y, emittance_t],
+    [emittance_x_i, emittance_y_i, emittance_t_i],
+    rtol=rtol,
+    atol=0.0,
+)
+
+# the beam is matched to the FODO cell: the beam size is periodic
+atol = 1.0  # a big number
+rtol = 2.0 * num_particles**-0.5  # from random sampling of a smooth distribution
+print(f"  beam size rtol={rtol} (ignored: atol~={atol})")
+assert np.allclose(
+    [sigx, sigy, sigt],
+    [sigx_i, sigy_i, sigt_i],
+    rtol=rtol,
+    atol=atol,
+)
@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022 ImpactX contributors
+# Authors: Axel Huebl, Chad Mitchell
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import amrex
+from impactx import ImpactX, elements
+
+sim = ImpactX()
+
+# set numerical parameters and IO control
+sim.set_particle_shape(2)  # B-spline order
+sim.set_space_charge(False)
+sim.set_track("envelope")
+# sim.set_diagnostics(False)  # benchmarking
+
+# domain decomposition & space charge mesh
+sim.init_grids()
+
+# load a 2 GeV electron beam with an initial
+# unnormalized rms emittance of 2 nm
+energy_MeV = 2.0e3  # reference energy
+
+#   reference particle
+ref = sim.particle_container().ref_particle()
+ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_energy_MeV(energy_MeV)
+
+#   beam envelope, with the parameters of the particle distributions
+sim.init_envelope(
+    sigmaX=3.9984884770e-5,
+    sigmaY=3.9984884770e-5,
+    sigmaT=1.0e-3,
+    sigmaPx=2.6623538760e-5,
+    sigmaPy=2.6623538760e-5,
+    sigmaPt=2.0e-3,
+    muxpx=-0.846574929020762,
+    muypy=0.846574929020762,
+    mutpt=0.0,
+)
+
+# design the accelerator lattice
+ns = 25  # number of slices per ds in the element
+fodo = [
+    elements.Drift(ds=0.25, nslice=ns),
+    elements.Quad(ds=1.0, k=1.0, nslice=ns),
+    elements.Drift(ds=0.5, nslice=ns),
+    elements.Quad(ds=1.0, k=-1.0, nslice=ns),
+    elements.Drift(ds=0.25, nslice=ns),
+]
+# assign a fodo segment
+sim.lattice.extend(fodo)
+
+# run simulation
+sim.evolve()
+
+# the covariance matrix of the beam at the end of the lattice
+print(sim.envelope())
+
+# clean shutdown
+del sim
+amrex.finalize()
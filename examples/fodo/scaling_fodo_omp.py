@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022 ImpactX contributors
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# Strong scaling of the FODO example over OpenMP threads: the same beam is
+# tracked with a varying number of threads, the results must not depend on
+# the number of threads.
+#
+
+import argparse
+import glob
+import os
+import subprocess
+import time
+
+import numpy as np
+import pandas as pd
+
+
+def read_all_files(file_pattern):
+    """Read in all CSV files from each MPI rank (and potentially OpenMP
+    thread). Concatenate into one Pandas dataframe.
+
+    Returns
+    -------
+    pandas.DataFrame
+    """
+    return pd.concat(
+        (
+            pd.read_csv(filename, delimiter=r"\s+")
+            for filename in glob.glob(file_pattern)
+        ),
+        axis=0,
+        ignore_index=True,
+    ).set_index("id")
+
+
+parser = argparse.ArgumentParser(description="OpenMP strong scaling of ImpactX")
+parser.add_argument("app", help="ImpactX executable")
+parser.add_argument("inputs", help="ImpactX inputs file")
+parser.add_argument(
+    "--threads", type=int, nargs="+", default=[1, 2, 4], help="OpenMP thread counts"
+)
+parser.add_argument(
+    "--npart", type=int, default=100000, help="number of beam particles"
+)
+args = parser.parse_args()
+
+# the same beam for all thread counts
+runtime_args = [
+    f"beam.npart={args.npart}",
+    "diag.slice_step_diagnostics=0",
+]
+
+timings = {}
+finals = {}
+for nthreads in args.threads:
+    run_dir = f"threads_{nthreads}"
+    os.makedirs(run_dir, exist_ok=True)
+    env = dict(os.environ, OMP_NUM_THREADS=str(nthreads))
+
+    start = time.perf_counter()
+    subprocess.run(
+        [args.app, args.inputs] + runtime_args, cwd=run_dir, env=env, check=True
+    )
+    timings[nthreads] = time.perf_counter() - start
+
+    finals[nthreads] = read_all_files(f"{run_dir}/diags/beam_final.*").sort_index()
+    assert args.npart == len(finals[nthreads])
+
+print("threads  time [s]  speedup")
+reference = args.threads[0]
+for nthreads in args.threads:
+    speedup = timings[reference] / timings[nthreads]
+    print(f"{nthreads:7d}  {timings[nthreads]:8.3f}  {speedup:7.2f}")
+
+# each particle is pushed independently: the result must not depend on the threads
+for nthreads in args.threads:
+    assert finals[nthreads].index.equals(finals[reference].index)
+    assert np.array_equal(finals[nthreads].values, finals[reference].values)
@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022 ImpactX contributors
+# Authors: Chad Mitchell, Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+
+import glob
+
+import numpy as np
+import pandas as pd
+from scipy.integrate import solve_ivp, trapezoid
+
+
+def read_all_files(file_pattern):
+    """Read in all CSV files from each MPI rank (and potentially OpenMP
+    thread). Concatenate into one Pandas dataframe.
+
+    Returns
+    -------
+    pandas.DataFrame
+    """
+    return pd.concat(
+        (
+            pd.read_csv(filename, delimiter=r"\s+")
+            for filename in glob.glob(file_pattern)
+        ),
+        axis=0,
+        ignore_index=True,
+    ).set_index("id")
+
+
+class OnAxisField:
+    """Fourier series of a normalized on-axis field map"""
+
+    def __init__(self, file_name, ncoef=25):
+        z, ez = np.loadtxt(file_name, unpack=True)
+        ez = ez / np.max(np.abs(ez))
+        self.length = z[-1] - z[0]
+        self.kl = 2.0 * np.pi / self.length
+        self.n = np.arange(ncoef)
+        theta = np.outer(self.n, self.kl * (z - z[0]))
+        self.a = 2.0 / self.length * trapezoid(ez * np.cos(theta), z, axis=1)
+        self.b = 2.0 / self.length * trapezoid(ez * np.sin(theta), z, axis=1)
+
+    def field(self, z):
+        theta = self.n[1:] * self.kl * z
+        return 0.5 * self.a[0] + np.sum(
+            self.a[1:] * np.cos(theta) + self.b[1:] * np.sin(theta)
+        )
+
+    def field_derivative(self, z):
+        theta = self.n[1:] * self.kl * z
+        return np.sum(
+            self.n[1:]
+            * self.kl
+            * (self.b[1:] * np.cos(theta) - self.a[1:] * np.sin(theta))
+        )
+
+
+def cavity(field, escale, k, phase_deg, gamma, t):
+    """Reference particle and linear transfer matrices of a cavity
+
+    Integrates the paraxial equations of motion of a particle with offsets
+    from the reference particle and takes finite differences.
+
+    Returns
+    -------
+    gamma and t of the reference particle at the exit,
+    transverse and longitudinal 2x2 transfer matrices
+    """
+    phase = np.radians(phase_deg)
+    t_entry = t
+
+    def rhs(z, u):
+        x, bgx, t, g = u
+        bg = np.sqrt(g**2 - 1.0)
+        beta = bg / g
+        phi = phase + k * (t - t_entry)
+        f = field.field(z)
+        fp = field.field_derivative(z)
+        return [
+            bgx / bg,
+            x / (2.0 * beta) * escale * (-fp * np.cos(phi) + beta * k * f * np.sin(phi)),
+            1.0 / beta,
+            escale * f * np.cos(phi),
+        ]
+
+    bg_in = np.sqrt(gamma**2 - 1.0)
+
+    def track(x, px, dt, pt):
+        u0 = [x, px * bg_in, t + dt, gamma - bg_in * pt]
+        sol = solve_ivp(
+            rhs, [0.0, field.length], u0, method="DOP853", rtol=1e-12, atol=1e-14
+        )
+        return sol.y[:, -1]
+
+    x_ref, _, t_ref, g_ref = track(0.0, 0.0, 0.0, 0.0)
+    bg_out = np.sqrt(g_ref**2 - 1.0)
+
+    def relative(u):
+        x, bgx, t, g = u
+        return np.array([x, bgx / bg_out, t - t_ref, -(g - g_ref) / bg_out])
+
+    eps = 1e-6
+    R = np.zeros((4, 4))
+    for j in range(4):
+        d = eps * np.eye(4)[j]
+        R[:, j] = (relative(track(*d)) - relative(track(*(-d)))) / (2.0 * eps)
+    return g_ref, t_ref, R[0:2, 0:2], R[2:4, 2:4]
+
+
+# initial/final beam on all ranks
+initial = read_all_files("diags/beam_000000.*")
+final = read_all_files("diags/beam_final.*")
+ref_particle = pd.read_csv("diags/ref_particle", delimiter=r"\s+")
+ref_final = pd.read_csv("diags/ref_particle_final", delimiter=r"\s+")
+
+# compare number of particles
+num_particles = 10000
+assert num_particles == len(initial)
+assert num_particles == len(final)
+
+# lattice of the example: cavity1 drift1 cavity2
+field = OnAxisField("onaxis_field.dat")
+escale = 0.0213  # 1/m
+k = 15.05  # 1/m
+drift_ds = 0.25  # m
+
+gamma = -ref_particle["pt"].iloc[0]
+t = ref_particle["t"].iloc[0]
+gamma, t, Rx1, Rt1 = cavity(field, escale, k, 60.0, gamma, t)
+bg2 = gamma**2 - 1.0
+Rx_drift = np.array([[1.0, drift_ds], [0.0, 1.0]])
+Rt_drift = np.array([[1.0, drift_ds / bg2], [0.0, 1.0]])
+t += drift_ds * gamma / np.sqrt(bg2)
+gamma, t, Rx2, Rt2 = cavity(field, escale, k, 30.0, gamma, t)
+Rx = Rx2 @ Rx_drift @ Rx1
+Rt = Rt2 @ Rt_drift @ Rt1
+
+# reference particle at the exit
+print(f"Reference energy gain: gamma={-ref_particle['pt'].iloc[0]} -> {gamma}")
+assert np.isclose(ref_final["pt"].iloc[0], -gamma, rtol=1e-9, atol=0.0)
+assert np.isclose(ref_final["t"].iloc[0], t, rtol=1e-9, atol=0.0)
+assert np.isclose(ref_final["s"].iloc[0], 2.0 * field.length + drift_ds)
+
+# all particles are pushed with the linear maps of the lattice
+initial = initial.loc[final.index]
+for u, pu, R in [("x", "px", Rx), ("y", "py", Rx), ("t", "pt", Rt)]:
+    expected_u = R[0, 0] * initial[u] + R[0, 1] * initial[pu]
+    expected_pu = R[1, 0] * initial[u] + R[1, 1] * initial[pu]
+    print(f"{u}-{pu} transfer matrix: {R.tolist()}")
+    assert np.allclose(final[u], expected_u, rtol=0.0, atol=1e-7 * np.std(final[u]))
+    assert np.allclose(
+        final[pu], expected_pu, rtol=0.0, atol=1e-7 * np.std(final[pu])
+    )
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022 ImpactX contributors
+# Authors: Chad Mitchell, Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import amrex
+from impactx import ImpactX, distribution, elements
+
+sim = ImpactX()
+
+# set numerical parameters and IO control
+sim.set_particle_shape(2)  # B-spline order
+sim.set_space_charge(False)
+# sim.set_diagnostics(False)  # benchmarking
+sim.set_slice_step_diagnostics(True)
+
+# domain decomposition & space charge mesh
+sim.init_grids()
+
+# load a 250 MeV proton beam
+energy_MeV = 250.0  # reference energy
+bunch_charge_C = 1.0e-9  # used with space charge
+npart = 10000  # number of macro particles
+
+#   reference particle
+ref = sim.particle_container().ref_particle()
+ref.set_charge_qe(1.0).set_mass_MeV(938.27208816).set_energy_MeV(energy_MeV)
+
+#   particle bunch
+distr = distribution.Waterbag(
+    sigmaX=1.0e-3,
+    sigmaY=1.0e-3,
+    sigmaT=1.0e-3,
+    sigmaPx=1.0e-4,
+    sigmaPy=1.0e-4,
+    sigmaPt=1.0e-4,
+)
+sim.add_particles(bunch_charge_C, distr, npart)
+
+# design the accelerator lattice:
+# two RF cavities sharing the same on-axis field map
+cavity1 = elements.RFCavity(
+    field_map="onaxis_field.dat",
+    escale=0.0213,
+    k=15.05,
+    phase=60.0,
+    nslice=4,
+    mapsteps=50,
+)
+drift1 = elements.Drift(ds=0.25)
+cavity2 = elements.RFCavity(
+    field_map="onaxis_field.dat",
+    escale=0.0213,
+    k=15.05,
+    phase=30.0,
+    nslice=4,
+    mapsteps=50,
+)
+sim.lattice.extend([cavity1, drift1, cavity2])
+
+# run simulation
+sim.evolve()
+
+# clean shutdown
+del sim
+amrex.finalize()
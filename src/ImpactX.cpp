@@ -9,18 +9,38 @@
  */
 #include "ImpactX.H"
 #include "initialization/InitOneBoxPerRank.H"
+#include "particles/AdaptiveSlicing.H"
+#include "particles/ComposeLinearMaps.H"
 #include "particles/ImpactXParticleContainer.H"
+#include "particles/LinearOptics.H"
 #include "particles/Push.H"
+#include "particles/ReferenceOrbit.H"
+#include "particles/SpaceChargeAlgo.H"
+#include "particles/SpaceChargeSplitting.H"
+#include "particles/TaylorMap.H"
+#ifdef ImpactX_USE_FFT
+#   include "particles/spacecharge/GatherAndPush.H"
+#   include "particles/spacecharge/PoissonSolve.H"
+#   include "particles/spacecharge/SpaceCharge2p5D.H"
+#endif
 #include "particles/transformation/CoordinateTransformation.H"
 #include "particles/diagnostics/DiagnosticOutput.H"
 
 #include <AMReX.H>
 #include <AMReX_AmrParGDB.H>
 #include <AMReX_BLProfiler.H>
+#include <AMReX_ParallelDescriptor.H>
 #include <AMReX_Print.H>
 #include <AMReX_Utility.H>
 
+#include <algorithm>
+#include <iterator>
+#include <list>
 #include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <variant>
 
 
 namespace impactx
@@ -29,10 +49,8 @@ namespace impactx
         : AmrCore(initialization::one_box_per_rank()),
           m_particle_container(std::make_unique<ImpactXParticleContainer>(this))
     {
-        // todo: if amr.n_cells is provided, overwrite/redefine AmrCore object
-
-        // todo: if charge deposition and/or space charge are requested, require
-        //       amr.n_cells from user inputs
+        // note: amr.n_cell is read in initGrids, since Python sets the
+        //       inputs only after the ImpactX object is constructed
     }
 
     void ImpactX::initGrids ()
@@ -43,6 +61,9 @@ namespace impactx
         // so that we can initialize the guard size of our MultiFabs
         m_particle_container->SetParticleShape();
 
+        // number of cells of the space charge mesh
+        initialization::set_n_cell(*this);
+
         // init blocks / grids & MultiFabs
         AmrCore::InitFromScratch(0.0);
         amrex::Print() << "boxArray(0) " << boxArray(0) << std::endl;
@@ -55,6 +76,37 @@ namespace impactx
     {
         BL_PROFILE("ImpactX::evolve");
 
+        // periodic lattice functions of one lattice period, without tracking
+        {
+            amrex::ParmParse pp_diag("diag");
+            bool diag_enable = true;
+            bool lattice_optics = false;
+            pp_diag.queryAdd("enable", diag_enable);
+            pp_diag.queryAdd("lattice_optics", lattice_optics);
+            if (diag_enable && lattice_optics)
+            {
+                LinearOptics const optics(m_lattice, m_particle_container->GetRefParticle());
+                amrex::Print() << " Tunes: " << optics.tune_x() << " " << optics.tune_y() << "\n"
+                               << " Chromaticities: " << optics.chromaticity_x() << " "
+                               << optics.chromaticity_y() << "\n";
+                optics.Print("diags/lattice_optics");
+            }
+        }
+
+        // track the beam envelope instead of beam particles
+        {
+            amrex::ParmParse pp_algo("algo");
+            std::string track = "particles";
+            pp_algo.queryAdd("track", track);
+            amrex::Print() << " Tracking: " << track << "\n";
+            if (track == "envelope") {
+                track_envelope();
+                return;
+            }
+            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(track == "particles",
+                                             "algo.track must be particles or envelope!");
+        }
+
         // a global step for diagnostics including space charge slice steps in elements
         //   before we start the evolve loop, we are in "step 0" (initial state)
         int global_step = 0;
@@ -104,98 +156,341 @@ namespace impactx
         }
 
         amrex::ParmParse pp_algo("algo");
-        bool space_charge = true;
-        pp_algo.queryAdd("space_charge", space_charge);
-        amrex::Print() << " Space Charge effects: " << space_charge << "\n";
+        SpaceChargeAlgo const space_charge_algo = get_space_charge_algo();
+        amrex::Print() << " Space Charge effects: " << to_string(space_charge_algo) << "\n";
+
+        // Space-charge calculation: turn off if there is only 1 particle
+        bool const space_charge = space_charge_algo != SpaceChargeAlgo::False &&
+                                  m_particle_container->TotalNumberOfParticles(false,false) > 1;
+
+        // number of periods, e.g., turns in a ring, to track through the lattice
+        amrex::ParmParse pp_lattice("lattice");
+        int periods = 1;
+        pp_lattice.queryAdd("periods", periods);
+        periods *= m_lattice_repeat;
+        amrex::Print() << " Lattice periods: " << periods << "\n";
+
+        // choose the number of space charge slices per element from the beam
+        amrex::Real slice_tolerance = 0.0;
+        pp_algo.queryAdd("slice_tolerance", slice_tolerance);
+        bool const adaptive_slicing = space_charge && slice_tolerance > 0.0;
+        amrex::Print() << " Adaptive slicing: " << adaptive_slicing << "\n";
+
+        std::list<KnownElements> sliced_lattice;
+        if (adaptive_slicing)
+        {
+            sliced_lattice = slice_lattice(envelope::beam_covariance(*m_particle_container),
+                                           slice_tolerance, diag_enable);
+        }
+        std::list<KnownElements> const & sliced = adaptive_slicing ? sliced_lattice : m_lattice;
+
+        // compose runs of linear elements into single transfer matrices
+        bool compose_linear_maps = false;
+        pp_algo.queryAdd("compose_linear_maps", compose_linear_maps);
+        amrex::Print() << " Composed linear maps: " << compose_linear_maps << "\n";
 
-        // loop over all beamline elements
-        for (auto & element_variant : m_lattice)
+        std::list<KnownElements> composed_lattice;
+        if (compose_linear_maps)
         {
-            // number of slices used for the application of space charge
-            int nslice = 1;
-            std::visit([&nslice](auto&& element){ nslice = element.nslice(); }, element_variant);
+            composed_lattice = ComposeLinearMaps(sliced,
+                                                 m_particle_container->GetRefParticle(),
+                                                 space_charge);
+            amrex::Print() << " Lattice of " << sliced.size() << " elements composed to "
+                           << composed_lattice.size() << " elements\n";
+        }
+        std::list<KnownElements> const & lattice = compose_linear_maps ? composed_lattice : sliced;
 
-            // sub-steps for space charge within the element
-            for (int slice_step = 0; slice_step < nslice; ++slice_step)
-            {
-                BL_PROFILE("ImpactX::evolve::slice_step");
-                global_step++;
-                amrex::Print() << " ++++ Starting global_step=" << global_step
-                               << " slice_step=" << slice_step << "\n";
-
-                // Space-charge calculation: turn off if there is only 1 particle
-                if (space_charge &&
-                    m_particle_container->TotalNumberOfParticles(false,false) > 1)
-                {
+        // the reference particle and the prepared elements at every element
+        // and slice boundary of one lattice period
+        ReferenceOrbit ref_orbit(lattice, m_particle_container->GetRefParticle());
+        int ref_orbit_step = 0;  // global step at the entry of ref_orbit
+        if (periods > 1)
+        {
+            amrex::Print() << " Reference orbit reused for all periods: "
+                           << ref_orbit.is_periodic() << "\n";
+        }
 
-                    // transform from x',y',t to x,y,z
-                    transformation::CoordinateTransformation(*m_particle_container,
-                                                             transformation::Direction::to_fixed_t);
+        // slice-step diagnostics
+        bool slice_step_diagnostics = false;
+        pp_diag.queryAdd("slice_step_diagnostics", slice_step_diagnostics);
 
-                    // Note: The following operation assume that
-                    // the particles are in x, y, z coordinates.
+        // period (e.g., turn-by-turn) diagnostics
+        int period_interval = 0;
+        pp_diag.queryAdd("period_interval", period_interval);
 
-                    // Resize the mesh, based on `m_particle_container` extent
-                    ResizeMesh();
+        // push consecutive elements without collective effects in one kernel
+        bool fuse_elements = false;
+        pp_algo.queryAdd("fuse_elements", fuse_elements);
+        if (fuse_elements && diag_enable && slice_step_diagnostics)
+        {
+            amrex::Print() << " Warning: algo.fuse_elements is disabled because "
+                           << "diag.slice_step_diagnostics is enabled\n";
+            fuse_elements = false;
+        }
+        amrex::Print() << " Fused element pushes: " << fuse_elements << "\n";
+
+        // push each period with the truncated Taylor map of the period
+        int taylor_map_order = 0;
+        pp_algo.queryAdd("taylor_map_order", taylor_map_order);
+        bool const has_aperture = m_aperture.has_value() ||
+            std::any_of(lattice.cbegin(), lattice.cend(), [](KnownElements const & element_variant){
+                return std::holds_alternative<Aperture>(element_variant);
+            });
+        if (taylor_map_order > 0 && (space_charge || has_aperture || (diag_enable && slice_step_diagnostics)))
+        {
+            amrex::Print() << " Warning: algo.taylor_map_order is disabled because space charge, "
+                           << "apertures or diag.slice_step_diagnostics are enabled\n";
+            taylor_map_order = 0;
+        }
+        amrex::Print() << " Taylor map order: " << taylor_map_order << "\n";
 
-                    // Redistribute particles in the new mesh in x, y, z
-                    m_particle_container->Redistribute();
+        std::optional<TaylorMap> taylor_map;
+        if (taylor_map_order > 0)
+        {
+            taylor_map.emplace(lattice, m_particle_container->GetRefParticle(), taylor_map_order);
+            amrex::Print() << " Taylor map of the lattice period has "
+                           << taylor_map->num_terms() << " terms\n";
+        }
 
-                    // charge deposition
-                    m_particle_container->DepositCharge(m_rho, this->refRatio());
+        // an element needs a collective step per slice if it has a length over which
+        // space charge acts
+        auto const needs_collective_step = [space_charge](KnownElements const & element_variant){
+            amrex::Real ds = 0.0;
+            std::visit([&ds](auto&& element){ ds = element.ds(); }, element_variant);
+            return space_charge && ds != 0.0;
+        };
+
+        // splitting of the space charge kicks and the slice maps; elements
+        // without sub-steps of their slices use at most second order
+        int space_charge_order = 1;
+        pp_algo.queryAdd("space_charge_order", space_charge_order);
+        SplittingCoefficients const splitting = SpaceChargeSplitting(space_charge_order);
+        SplittingCoefficients const splitting_whole_slices = SpaceChargeSplitting(std::min(space_charge_order, 2));
+        if (space_charge)
+        {
+            amrex::Print() << " Space charge splitting order: " << space_charge_order << "\n";
+        }
 
-                    // poisson solve in x,y,z
-                    //   TODO
+        // keep the space charge mesh while the beam still fits it, \see ResizeMesh
+        pp_algo.queryAdd("mesh_resize_tolerance", m_mesh_resize_tolerance);
 
-                    // gather and space-charge push in x,y,z , assuming the space-charge
-                    // field is the same before/after transformation
-                    //   TODO
+        // the kick at the exit of a slice is merged with the kick at the entry
+        // of the next slice, at the same position
+        amrex::Real pending_kick_ds = 0.0;
+        auto const apply_pending_kick = [this, &pending_kick_ds, space_charge_algo](){
+            if (pending_kick_ds != 0.0)
+            {
+                space_charge_step(pending_kick_ds, space_charge_algo);
+                pending_kick_ds = 0.0;
+            }
+        };
+
+        // loop over all lattice periods
+        for (int period = 0; period < periods; ++period)
+        {
+            if (periods > 1)
+            {
+                amrex::Print() << " ++++ Starting period=" << period << "\n";
+            }
 
-                    // transform from x,y,z to x',y',t
-                    transformation::CoordinateTransformation(*m_particle_container,
-                                                             transformation::Direction::to_fixed_s);
+            // the reference energy or direction changed over the last period:
+            // recompute the linear maps and the reference orbit for this period
+            if (period > 0 && !ref_orbit.is_periodic())
+            {
+                if (compose_linear_maps)
+                {
+                    composed_lattice = ComposeLinearMaps(sliced,
+                                                         m_particle_container->GetRefParticle(),
+                                                         space_charge);
+                }
+                ref_orbit = ReferenceOrbit(lattice, m_particle_container->GetRefParticle());
+                ref_orbit_step = global_step;
+                if (taylor_map)
+                {
+                    taylor_map.emplace(lattice, m_particle_container->GetRefParticle(), taylor_map_order);
                 }
+            }
 
-                // for later: original Impact implementation as an option
-                // Redistribute particles in x',y',t
-                //   TODO: only needed if we want to gather and push space charge
-                //         in x',y',t
-                //   TODO: change geometry beforehand according to transformation
-                //m_particle_container->Redistribute();
-                //
-                // in original Impact, we gather and space-charge push in x',y',t ,
-                // assuming that the distribution did not change
+            // push all particles through the whole period with the Taylor map
+            if (taylor_map)
+            {
+                BL_PROFILE("ImpactX::evolve::taylor_map");
+                amrex::Print() << " ++++ Starting global_step=" << global_step + 1
+                               << " Taylor map of " << ref_orbit.num_steps() << " slice steps\n";
 
-                // push all particles with external maps
-                Push(*m_particle_container, element_variant);
+                Push(*m_particle_container, *taylor_map);
+                global_step += ref_orbit.num_steps();
+                m_particle_container->SetRefParticle(ref_orbit.at(global_step - ref_orbit_step));
 
-                // just prints an empty newline at the end of the slice_step
+                // just prints an empty newline at the end of the period
                 amrex::Print() << "\n";
+            }
+
+            // loop over all beamline elements, unless the Taylor map pushed the period
+            auto element_it = taylor_map ? lattice.cend() : lattice.cbegin();
+            while (element_it != lattice.cend())
+            {
+                if (fuse_elements && !needs_collective_step(*element_it))
+                {
+                    // collect the longest segment of consecutive elements that
+                    // need no collective step; an aperture ends a segment, so
+                    // particles lost in it are recorded at its position
+                    auto const segment_begin = element_it;
+                    int nsteps = 0;
+                    while (element_it != lattice.cend() && !needs_collective_step(*element_it))
+                    {
+                        std::visit([&nsteps](auto&& element){ nsteps += element.nslice(); }, *element_it);
+                        bool const is_aperture = std::holds_alternative<Aperture>(*element_it);
+                        ++element_it;
+                        if (is_aperture) { break; }
+                    }
+
+                    // performance profiling per segment
+                    std::string const profile_name = "ImpactX::evolve::segment_" +
+                        std::to_string(std::distance(lattice.cbegin(), segment_begin)) + "-" +
+                        std::to_string(std::distance(lattice.cbegin(), element_it) - 1);
+                    BL_PROFILE(profile_name);
+
+                    apply_pending_kick();
+                    amrex::Print() << " ++++ Starting global_step=" << global_step + 1
+                                   << " fused segment of " << std::distance(segment_begin, element_it)
+                                   << " elements and " << nsteps << " slice steps\n";
+
+                    // push all particles with external maps through the whole segment
+                    int const nlost = Push(*m_particle_container, ref_orbit,
+                                           global_step - ref_orbit_step, nsteps, m_aperture);
+                    global_step += nsteps;
+                    m_particle_container->SetRefParticle(ref_orbit.at(global_step - ref_orbit_step));
+
+                    // remove lost particles at the end of the segment
+                    if (nlost > 0)
+                    {
+                        m_particle_container->RemoveLostParticles(m_particle_container->GetRefParticle().s);
+                    }
+
+                    // just prints an empty newline at the end of the segment
+                    amrex::Print() << "\n";
+
+                    continue;
+                }
 
-                // slice-step diagnostics
-                bool slice_step_diagnostics = false;
-                pp_diag.queryAdd("slice_step_diagnostics", slice_step_diagnostics);
+                // number of slices used for the application of space charge
+                int nslice = 1;
+                std::visit([&nslice](auto&& element){ nslice = element.nslice(); }, *element_it);
 
-                if (diag_enable && slice_step_diagnostics)
+                // sub-steps for space charge within the element
+                for (int slice_step = 0; slice_step < nslice; ++slice_step)
+                {
+                    BL_PROFILE("ImpactX::evolve::slice_step");
+                    global_step++;
+                    amrex::Print() << " ++++ Starting global_step=" << global_step
+                                   << " slice_step=" << slice_step << "\n";
+
+                    int const step = global_step - 1 - ref_orbit_step;
+                    KnownElements const & element_variant = ref_orbit.element(step);
+                    RefPart const & ref_part = ref_orbit.at(step);
+
+                    // length of the slice over which space charge acts
+                    amrex::Real slice_ds = 0.0;
+                    if (needs_collective_step(element_variant))
+                    {
+                        std::visit([&slice_ds](auto&& element){ slice_ds = element.ds() / element.nslice(); },
+                                   element_variant);
+                    }
+                    SplittingCoefficients const & split =
+                        (slice_ds != 0.0 && has_sub_steps(element_variant)) ? splitting : splitting_whole_slices;
+
+                    // push all particles with external maps, between space charge kicks;
+                    // the positions between the map sub-steps are not on the physical
+                    // orbit, so the global aperture is only checked after the last one
+                    int nlost = 0;
+                    for (std::size_t sub_step = 0; sub_step < split.map.size(); ++sub_step)
+                    {
+                        pending_kick_ds += split.kick[sub_step] * slice_ds;
+                        apply_pending_kick();
+
+                        bool const last_sub_step = sub_step + 1 == split.map.size();
+                        std::optional<Aperture> const aperture =
+                            last_sub_step ? m_aperture : std::nullopt;
+                        if (split.map[sub_step] == 1.0) {
+                            nlost += Push(*m_particle_container, element_variant, ref_part, aperture);
+                        } else {
+                            nlost += Push(*m_particle_container,
+                                          SubStep(element_variant, split.map[sub_step], ref_part),
+                                          ref_part, aperture);
+                        }
+                    }
+                    m_particle_container->SetRefParticle(ref_orbit.at(step + 1));
+                    pending_kick_ds += split.kick.back() * slice_ds;
+
+                    // remove lost particles at the end of the slice step
+                    if (nlost > 0)
+                    {
+                        m_particle_container->RemoveLostParticles(m_particle_container->GetRefParticle().s);
+                    }
+
+                    // just prints an empty newline at the end of the slice_step
+                    amrex::Print() << "\n";
+
+                    // slice-step diagnostics
+                    if (diag_enable && slice_step_diagnostics)
+                    {
+                        apply_pending_kick();
+
+                        // print slice step particle distribution to file
+                        std::string diag_name = amrex::Concatenate("diags/beam_", global_step, file_min_digits);
+                        diagnostics::DiagnosticOutput(*m_particle_container,
+                                                      diagnostics::OutputType::PrintParticles,
+                                                      diag_name,
+                                                      global_step);
+
+                        // print slice step reference particle to file
+                        diagnostics::DiagnosticOutput(*m_particle_container,
+                                                      diagnostics::OutputType::PrintRefParticle,
+                                                      "diags/ref_particle",
+                                                      global_step,
+                                                      true);
+                    }
+
+                } // end in-element space-charge slice-step loop
+
+                ++element_it;
+            } // end beamline element loop
+            apply_pending_kick();
+
+            // period diagnostics
+            if (diag_enable && period_interval > 0 && (period + 1) % period_interval == 0)
+            {
+                // print particle distribution and reference particle to file,
+                // unless done as slice step diagnostics
+                if (!slice_step_diagnostics)
                 {
-                    // print slice step particle distribution to file
                     std::string diag_name = amrex::Concatenate("diags/beam_", global_step, file_min_digits);
                     diagnostics::DiagnosticOutput(*m_particle_container,
                                                   diagnostics::OutputType::PrintParticles,
                                                   diag_name,
                                                   global_step);
 
-                    // print slice step reference particle to file
                     diagnostics::DiagnosticOutput(*m_particle_container,
                                                   diagnostics::OutputType::PrintRefParticle,
                                                   "diags/ref_particle",
                                                   global_step,
                                                   true);
-
                 }
 
-            } // end in-element space-charge slice-step loop
-        } // end beamline element loop
+                // print the values of the two invariants H and I
+                std::string diag_name = amrex::Concatenate("diags/nonlinear_lens_invariants_", global_step, file_min_digits);
+                diagnostics::DiagnosticOutput(*m_particle_container,
+                                              diagnostics::OutputType::PrintNonlinearLensInvariants,
+                                              diag_name,
+                                              global_step);
+            }
+        } // end lattice period loop
+
+        // total number of lost particles over all MPI ranks
+        amrex::Long nlost_total = m_particle_container->GetLossRecord().size();
+        amrex::ParallelDescriptor::ReduceLongSum(nlost_total);
+        amrex::Print() << " Lost particles: " << nlost_total << "\n";
 
         if (diag_enable)
         {
@@ -216,7 +511,299 @@ namespace impactx
                                           diagnostics::OutputType::PrintNonlinearLensInvariants,
                                           "diags/nonlinear_lens_invariants_final",
                                           global_step);
+
+            // print the lost particles and where they were lost to file
+            diagnostics::DiagnosticOutput(*m_particle_container,
+                                          diagnostics::OutputType::PrintLostParticles,
+                                          "diags/particles_lost",
+                                          global_step);
+        }
+
+    }
+
+    std::list<KnownElements>
+    ImpactX::slice_lattice (envelope::CovarianceMatrix const & cm,
+                            amrex::Real tolerance,
+                            bool diag_enable) const
+    {
+        BL_PROFILE("ImpactX::slice_lattice");
+
+        amrex::ParmParse pp_algo("algo");
+        int max_nslice = 100;
+        pp_algo.queryAdd("max_nslice", max_nslice);
+
+        std::list<KnownElements> sliced = AdaptiveSlicing(m_lattice,
+                                                          m_particle_container->GetRefParticle(),
+                                                          cm, tolerance, max_nslice);
+        int nsteps = 0;
+        for (auto const & element_variant : sliced)
+        {
+            std::visit([&nsteps](auto&& element){ nsteps += element.nslice(); }, element_variant);
+        }
+        amrex::Print() << " Lattice sliced to " << nsteps << " slice steps per period\n";
+
+        if (diag_enable)
+        {
+            // print the number of slices per element to file
+            PrintSlicing(sliced, "diags/slicing");
+        }
+        return sliced;
+    }
+
+    void ImpactX::space_charge_step ([[maybe_unused]] amrex::Real const ds,
+                                     [[maybe_unused]] SpaceChargeAlgo const algo)
+    {
+        BL_PROFILE("ImpactX::space_charge_step");
+
+#ifdef ImpactX_USE_FFT
+        // 2.5D: deposit, solve and push on grids that every MPI rank holds
+        // in full, so the particles need not be redistributed and are only
+        // transformed to x,y,z on the fly, without storing them
+        if (algo == SpaceChargeAlgo::TwoAndAHalfD)
+        {
+            // Resize the mesh, based on the extent of the beam in x,y,z,
+            // unless the beam still fits the mesh of the last step
+            ResizeMesh(transformation::MinAndMaxAtFixedT(*m_particle_container), true);
+
+            spacecharge::SpaceCharge2p5D(*m_particle_container, ds, m_poisson_solver_2d);
+            return;
+        }
+#endif
+
+        // A kept mesh is only possible with a resize tolerance. Then the
+        // particles stay in x',y',t as long as they are at most a cell outside
+        // of their box at fixed t, and are transformed to x,y,z on the fly.
+        bool const may_keep_mesh = m_mesh_resize_tolerance > 0.0;
+
+        // reduce the extent of the particles at fixed t; unless the mesh may
+        // be kept, transform from x',y',t to x,y,z in the same pass over the
+        // particle data
+        auto const extent = may_keep_mesh ?
+            transformation::MinAndMaxAtFixedT(*m_particle_container) :
+            transformation::ToFixedTAndMinMax(*m_particle_container);
+
+        // Resize the mesh, based on `m_particle_container` extent, unless
+        // the beam still fits the mesh of the last step
+        bool const mesh_resized = ResizeMesh(extent, true);
+
+        bool const on_the_fly = may_keep_mesh && !mesh_resized &&
+                                m_particle_container->NearOwnBoxes(1, true);
+
+        if (!on_the_fly)
+        {
+            // transform from x',y',t to x,y,z
+            if (may_keep_mesh) {
+                transformation::CoordinateTransformation(*m_particle_container,
+                                                         transformation::Direction::to_fixed_t);
+            }
+
+            // Note: The following operation assume that
+            // the particles are in x, y, z coordinates.
+
+            // Redistribute particles in the new mesh in x, y, z; in an unchanged
+            // mesh, particles that moved by less than a blocking factor since the
+            // last step are only exchanged with neighboring boxes
+            int const local = blockingFactor(0).min();
+            if (mesh_resized || !m_particle_container->NearOwnBoxes(local)) {
+                m_particle_container->Redistribute();
+            } else {
+                int const lev_min = 0;
+                int const lev_max = finestLevel();
+                int const nGrow = 0;
+                m_particle_container->Redistribute(lev_min, lev_max, nGrow, local);
+            }
+        }
+
+        // charge deposition
+        m_particle_container->DepositCharge(m_rho, this->refRatio(), on_the_fly);
+
+#ifdef ImpactX_USE_FFT
+        // poisson solve in x,y,z
+        spacecharge::PoissonSolve(*m_particle_container, m_rho, m_phi, m_space_charge_field,
+                                  m_poisson_solver);
+
+        // gather and space-charge push in x,y,z over the length ds, assuming
+        // the space-charge field is the same before/after transformation
+        spacecharge::GatherAndPush(*m_particle_container, m_space_charge_field, ds, on_the_fly);
+#else
+        static bool warned = false;
+        if (!warned)
+        {
+            amrex::Print() << "WARNING: ImpactX was built without ImpactX_FFT: the charge is "
+                           << "deposited, but the beam is not pushed by its space charge field\n";
+            warned = true;
+        }
+#endif
+
+        // transform from x,y,z to x',y',t
+        if (!on_the_fly) {
+            transformation::CoordinateTransformation(*m_particle_container,
+                                                     transformation::Direction::to_fixed_s);
+        }
+
+        // for later: original Impact implementation as an option
+        // Redistribute particles in x',y',t
+        //   TODO: only needed if we want to gather and push space charge
+        //         in x',y',t
+        //   TODO: change geometry beforehand according to transformation
+        //m_particle_container->Redistribute();
+        //
+        // in original Impact, we gather and space-charge push in x',y',t ,
+        // assuming that the distribution did not change
+    }
+
+    void ImpactX::track_envelope ()
+    {
+        BL_PROFILE("ImpactX::track_envelope");
+
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(m_envelope.has_value(),
+            "track_envelope: beam envelope not initialized, see init_envelope!");
+
+        amrex::ParmParse pp_diag("diag");
+        bool diag_enable = true;
+        pp_diag.queryAdd("enable", diag_enable);
+        amrex::Print() << " Diagnostics: " << diag_enable << "\n";
+
+        // slice-step diagnostics of the reference particle
+        bool slice_step_diagnostics = false;
+        pp_diag.queryAdd("slice_step_diagnostics", slice_step_diagnostics);
+
+        // linear space charge of a beam with uniform current
+        amrex::ParmParse pp_algo("algo");
+        bool const space_charge = get_space_charge_algo() != SpaceChargeAlgo::False &&
+                                  m_beam_current != 0.0;
+        amrex::Print() << " Linear space charge: " << space_charge << "\n";
+
+        // number of periods, e.g., turns in a ring, to track through the lattice
+        amrex::ParmParse pp_lattice("lattice");
+        int periods = 1;
+        pp_lattice.queryAdd("periods", periods);
+        periods *= m_lattice_repeat;
+        amrex::Print() << " Lattice periods: " << periods << "\n";
+
+        // choose the number of space charge slices per element from the envelope
+        amrex::Real slice_tolerance = 0.0;
+        pp_algo.queryAdd("slice_tolerance", slice_tolerance);
+        bool const adaptive_slicing = space_charge && slice_tolerance > 0.0;
+        amrex::Print() << " Adaptive slicing: " << adaptive_slicing << "\n";
+
+        std::list<KnownElements> sliced_lattice;
+        if (adaptive_slicing)
+        {
+            sliced_lattice = slice_lattice(*m_envelope, slice_tolerance, diag_enable);
+        }
+        std::list<KnownElements> const & lattice = adaptive_slicing ? sliced_lattice : m_lattice;
+
+        // splitting of the space charge kicks and the slice maps; elements
+        // without sub-steps of their slices use at most second order
+        int space_charge_order = 2;
+        pp_algo.queryAdd("space_charge_order", space_charge_order);
+        SplittingCoefficients const splitting = SpaceChargeSplitting(space_charge_order);
+        SplittingCoefficients const splitting_whole_slices = SpaceChargeSplitting(std::min(space_charge_order, 2));
+        if (space_charge)
+        {
+            amrex::Print() << " Space charge splitting order: " << space_charge_order << "\n";
+        }
+
+        // the reference particle and the prepared elements at every element
+        // and slice boundary of one lattice period
+        ReferenceOrbit ref_orbit(lattice, m_particle_container->GetRefParticle());
+        int ref_orbit_step = 0;  // global step at the entry of ref_orbit
+
+        // rms sizes and emittances of all global steps, written at once
+        std::ostringstream envelope_diag;
+        envelope_diag.precision(17);
+        envelope_diag << envelope::print_header;
+
+        int global_step = 0;
+        envelope::CovarianceMatrix cm = *m_envelope;
+        envelope::PrintLine(envelope_diag, global_step, m_particle_container->GetRefParticle(), cm);
+        if (diag_enable)
+        {
+            // print initial reference particle to file
+            diagnostics::DiagnosticOutput(*m_particle_container,
+                                          diagnostics::OutputType::PrintRefParticle,
+                                          "diags/ref_particle",
+                                          global_step);
+        }
+
+        // loop over all lattice periods
+        for (int period = 0; period < periods; ++period)
+        {
+            // the reference energy or direction changed over the last period:
+            // recompute the reference orbit for this period
+            if (period > 0 && !ref_orbit.is_periodic())
+            {
+                ref_orbit = ReferenceOrbit(lattice, m_particle_container->GetRefParticle());
+                ref_orbit_step = global_step;
+            }
+
+            // loop over all slice steps of the period
+            for (int n = 0; n < ref_orbit.num_steps(); ++n)
+            {
+                int const step = global_step - ref_orbit_step;
+                KnownElements const & element_variant = ref_orbit.element(step);
+                RefPart const ref_part = ref_orbit.at(step);
+
+                // length of the slice for space charge
+                amrex::Real slice_ds = 0.0;
+                if (space_charge)
+                {
+                    std::visit([&slice_ds](auto&& element){ slice_ds = element.ds() / element.nslice(); },
+                               element_variant);
+                }
+
+                // transport the envelope with the linear maps of the slice, between
+                // kicks of linear space charge with the perveance at their position
+                SplittingCoefficients const & split =
+                    (slice_ds != 0.0 && has_sub_steps(element_variant)) ? splitting : splitting_whole_slices;
+                auto const kick = [&](amrex::Real const fraction){
+                    if (slice_ds != 0.0 && fraction != 0.0)
+                    {
+                        envelope::space_charge_kick(cm, envelope::perveance(m_beam_current,
+                                                                            m_particle_container->GetRefParticle()),
+                                                    fraction * slice_ds);
+                    }
+                };
+                for (std::size_t sub_step = 0; sub_step < split.map.size(); ++sub_step)
+                {
+                    kick(split.kick[sub_step]);
+                    if (split.map[sub_step] == 1.0) {
+                        cm = envelope::transport(envelope::linear_map(element_variant, ref_part), cm);
+                    } else {
+                        cm = envelope::transport(envelope::linear_map(SubStep(element_variant, split.map[sub_step], ref_part),
+                                                                      ref_part), cm);
+                    }
+                }
+                ++global_step;
+                m_particle_container->SetRefParticle(ref_orbit.at(global_step - ref_orbit_step));
+                kick(split.kick.back());
+
+                envelope::PrintLine(envelope_diag, global_step, m_particle_container->GetRefParticle(), cm);
+
+                // print slice step reference particle to file
+                if (diag_enable && slice_step_diagnostics)
+                {
+                    diagnostics::DiagnosticOutput(*m_particle_container,
+                                                  diagnostics::OutputType::PrintRefParticle,
+                                                  "diags/ref_particle",
+                                                  global_step,
+                                                  true);
+                }
+            }
         }
+        m_envelope = cm;
 
+        if (diag_enable)
+        {
+            // print the envelope of all global steps to file
+            amrex::PrintToFile("diags/envelope") << envelope_diag.str();
+
+            // print final reference particle to file
+            diagnostics::DiagnosticOutput(*m_particle_container,
+                                          diagnostics::OutputType::PrintRefParticle,
+                                          "diags/ref_particle_final",
+                                          global_step);
+        }
     }
 } // namespace impactx
@@ -87,6 +87,24 @@ namespace impactx
         m_particle_container->Redistribute();
     }
 
+    void
+    ImpactX::init_envelope (
+        envelope::CovarianceMatrix const & cm,
+        amrex::Real current
+    )
+    {
+        BL_PROFILE("ImpactX::init_envelope");
+
+        auto const & ref = m_particle_container->GetRefParticle();
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(ref.mass_MeV() != 0.0,
+                                         "init_envelope: Reference particle mass not yet set!");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(current == 0.0 || ref.charge_qe() != 0.0,
+                                         "init_envelope: Reference particle charge not yet set!");
+
+        m_envelope = cm;
+        m_beam_current = current;
+    }
+
     void ImpactX::initBeamDistributionFromInputs ()
     {
         BL_PROFILE("ImpactX::initBeamDistributionFromInputs");
@@ -123,6 +141,40 @@ namespace impactx
         m_particle_container->GetRefParticle()
             .set_charge_qe(qe).set_mass_MeV(massE).set_energy_MeV(energy);
 
+        // envelope tracking: the beam is described by its second moments,
+        // which are the same for all distribution types
+        amrex::ParmParse pp_algo("algo");
+        std::string track = "particles";
+        pp_algo.queryAdd("track", track);
+        if (track == "envelope")
+        {
+            amrex::ParticleReal sigx,sigy,sigt,sigpx,sigpy,sigpt;
+            amrex::ParticleReal muxpx = 0.0, muypy = 0.0, mutpt = 0.0;
+            pp_dist.get("sigmaX", sigx);
+            pp_dist.get("sigmaY", sigy);
+            pp_dist.get("sigmaT", sigt);
+            pp_dist.get("sigmaPx", sigpx);
+            pp_dist.get("sigmaPy", sigpy);
+            pp_dist.get("sigmaPt", sigpt);
+            pp_dist.query("muxpx", muxpx);
+            pp_dist.query("muypy", muypy);
+            pp_dist.query("mutpt", mutpt);
+
+            amrex::ParticleReal current = 0.0;  // Beam current (A)
+            pp_dist.queryAdd("current", current);
+
+            init_envelope(envelope::create_covariance(sigx, sigy, sigt,
+                                                      sigpx, sigpy, sigpt,
+                                                      muxpx, muypy, mutpt),
+                          current);
+
+            amrex::Print() << "Beam kinetic energy (MeV): " << energy << std::endl;
+            amrex::Print() << "Beam current (A): " << current << std::endl;
+            amrex::Print() << "Particle type: " << particle_type << std::endl;
+            amrex::Print() << "Initialized beam envelope" << std::endl;
+            return;
+        }
+
         int npart = 1;  // Number of simulation particles
         pp_dist.get("npart", npart);
 
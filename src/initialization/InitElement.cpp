@@ -16,18 +16,294 @@
 #include <AMReX_ParmParse.H>
 #include <AMReX_Print.H>
 
+#include <algorithm>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 
 namespace impactx
 {
+namespace
+{
+    /** Read the parameters of an aperture
+     *
+     * @param pp the ParmParse prefix of the aperture
+     * @returns the aperture
+     */
+    Aperture read_aperture (amrex::ParmParse const & pp)
+    {
+        amrex::Real xmax, ymax;
+        std::string shape = "rectangular";
+        pp.get("xmax", xmax);
+        pp.get("ymax", ymax);
+        pp.query("shape", shape);
+
+        if (shape == "rectangular") {
+            return Aperture(xmax, ymax, Aperture::Shape::rectangular);
+        } else if (shape == "elliptical") {
+            return Aperture(xmax, ymax, Aperture::Shape::elliptical);
+        } else {
+            amrex::Abort("Unknown aperture shape in " + pp.getPrefix() + ": " + shape);
+            return Aperture(xmax, ymax);
+        }
+    }
+
+    /** Read a lattice element
+     *
+     * @param element_name the name of the element
+     * @param element_type the type of the element
+     * @param nslice_default the default number of slices per element
+     * @returns the element
+     */
+    KnownElements read_element (std::string const & element_name,
+                                std::string const & element_type,
+                                int const nslice_default)
+    {
+        amrex::ParmParse pp_element(element_name);
+
+        // Initialize the corresponding element according to its type
+        if (element_type == "quad") {
+            amrex::Real ds, k;
+            int nslice = nslice_default;
+            pp_element.get("ds", ds);
+            pp_element.get("k", k);
+            pp_element.queryAdd("nslice", nslice);
+            return Quad(ds, k, nslice);
+        } else if (element_type == "drift") {
+            amrex::Real ds;
+            int nslice = nslice_default;
+            pp_element.get("ds", ds);
+            pp_element.queryAdd("nslice", nslice);
+            return Drift(ds, nslice);
+        } else if (element_type == "sbend") {
+            amrex::Real ds, rc;
+            int nslice = nslice_default;
+            pp_element.get("ds", ds);
+            pp_element.get("rc", rc);
+            pp_element.queryAdd("nslice", nslice);
+            return Sbend(ds, rc, nslice);
+        } else if (element_type == "dipedge") {
+            amrex::Real psi, rc, g, K2;
+            pp_element.get("psi", psi);
+            pp_element.get("rc", rc);
+            pp_element.get("g", g);
+            pp_element.get("K2", K2);
+            return DipEdge(psi, rc, g, K2);
+        } else if (element_type == "constf") {
+            amrex::Real ds, kx, ky, kt;
+            int nslice = nslice_default;
+            pp_element.get("ds", ds);
+            pp_element.get("kx", kx);
+            pp_element.get("ky", ky);
+            pp_element.get("kt", kt);
+            pp_element.queryAdd("nslice", nslice);
+            return ConstF(ds, kx, ky, kt, nslice);
+        } else if (element_type == "shortrf") {
+            amrex::Real V, k;
+            pp_element.get("V", V);
+            pp_element.get("k", k);
+            return ShortRF(V, k);
+        } else if (element_type == "rfcavity") {
+            std::string field_map;
+            amrex::Real escale, k, phase;
+            int nslice = nslice_default;
+            int mapsteps = 1;
+            int ncoef = 25;
+            pp_element.get("field_map", field_map);
+            pp_element.get("escale", escale);
+            pp_element.get("k", k);
+            pp_element.get("phase", phase);
+            pp_element.queryAdd("nslice", nslice);
+            pp_element.queryAdd("mapsteps", mapsteps);
+            pp_element.queryAdd("ncoef", ncoef);
+            return RFCavity(field_map, escale, k, phase, nslice, mapsteps, ncoef);
+        } else if (element_type == "multipole") {
+            int m;
+            amrex::Real k_normal, k_skew;
+            pp_element.get("multipole", m);
+            pp_element.get("k_normal", k_normal);
+            pp_element.get("k_skew", k_skew);
+            return Multipole(m, k_normal, k_skew);
+        } else if (element_type == "thick_multipole") {
+            amrex::Real ds;
+            std::vector<amrex::Real> k_normal, k_skew;
+            int nslice = nslice_default;
+            int int_order = 2;
+            int mapsteps = 1;
+            pp_element.get("ds", ds);
+            pp_element.queryarr("k_normal", k_normal);
+            pp_element.queryarr("k_skew", k_skew);
+            pp_element.queryAdd("nslice", nslice);
+            pp_element.queryAdd("int_order", int_order);
+            pp_element.queryAdd("mapsteps", mapsteps);
+            return ThickMultipole(ds, k_normal, k_skew, nslice, int_order, mapsteps);
+        } else if (element_type == "thin_multipole") {
+            std::vector<amrex::Real> k_normal, k_skew;
+            pp_element.queryarr("k_normal", k_normal);
+            pp_element.queryarr("k_skew", k_skew);
+            return ThinMultipole(k_normal, k_skew);
+        } else if (element_type == "nonlinear_lens") {
+            amrex::Real knll, cnll;
+            pp_element.get("knll", knll);
+            pp_element.get("cnll", cnll);
+            amrex::Real series_tolerance = 0.0;
+            pp_element.query("series_tolerance", series_tolerance);
+            return NonlinearLens(knll, cnll, series_tolerance);
+        } else if (element_type == "aperture") {
+            return read_aperture(pp_element);
+        } else {
+            amrex::Abort("Unknown type for lattice element " + element_name + ": " + element_type);
+            return None();
+        }
+    }
+
+    /** Expand named beamlines into a sequence of elements
+     *
+     * A beamline has the type ``line`` and a list of ``elements``, which are
+     * element or beamline names. A leading ``-`` reverses a beamline and
+     * ``repeat`` repeats it. Each distinct element is read only once and
+     * stored once, the expanded sequence refers to it by index. Each
+     * beamline is expanded only once as well, but the sequence holds one
+     * index per element along the lattice, including all repetitions and
+     * reversals of nested beamlines.
+     */
+    class BeamlineExpansion
+    {
+    public:
+        /** Prepare the expansion of beamlines
+         *
+         * @param nslice_default the default number of slices per element
+         */
+        explicit BeamlineExpansion (int const nslice_default)
+        : m_nslice_default(nslice_default)
+        {
+        }
+
+        /** Check if a name refers to a beamline
+         *
+         * @param name element or beamline name, without a leading "-"
+         * @returns true for a beamline
+         */
+        static bool is_line (std::string const & name)
+        {
+            amrex::ParmParse pp_element(name);
+            std::string element_type;
+            pp_element.get("type", element_type);
+            return element_type == "line";
+        }
+
+        /** Append an element or beamline to a sequence
+         *
+         * @param name element or beamline name, a leading "-" reverses a beamline
+         * @param repeat apply the repeat count of a beamline (true) or expand it once (false)
+         * @param[in,out] sequence the sequence of element indices to append to
+         */
+        void append (std::string name, bool const repeat, std::vector<int> & sequence)
+        {
+            bool const reverse = !name.empty() && name[0] == '-';
+            if (reverse) { name = name.substr(1); }
+
+            if (!is_line(name)) {
+                sequence.push_back(element(name));
+                return;
+            }
+
+            std::vector<int> const & body = line(name);
+            int const nrepeat = repeat ? line_repeat(name) : 1;
+            for (int r = 0; r < nrepeat; ++r) {
+                if (reverse) {
+                    sequence.insert(sequence.end(), body.rbegin(), body.rend());
+                } else {
+                    sequence.insert(sequence.end(), body.begin(), body.end());
+                }
+            }
+        }
+
+        /** Repeat count of a beamline
+         *
+         * @param name beamline name
+         * @returns the number of repetitions (default: 1)
+         */
+        static int line_repeat (std::string const & name)
+        {
+            amrex::ParmParse pp_line(name);
+            int repeat = 1;
+            pp_line.query("repeat", repeat);
+            if (repeat < 1) {
+                amrex::Abort("Repeat count of lattice line " + name + " must be positive");
+            }
+            return repeat;
+        }
+
+        /** The distinct elements, indexed by the expanded sequence */
+        std::vector<KnownElements> const & elements () const { return m_elements; }
+
+    private:
+        /** Index of an element, read on first use
+         *
+         * @param name element name
+         * @returns index into elements()
+         */
+        int element (std::string const & name)
+        {
+            auto const it = m_element_index.find(name);
+            if (it != m_element_index.end()) { return it->second; }
+
+            amrex::ParmParse pp_element(name);
+            std::string element_type;
+            pp_element.get("type", element_type);
+            m_elements.push_back(read_element(name, element_type, m_nslice_default));
+
+            int const index = static_cast<int>(m_elements.size()) - 1;
+            m_element_index.emplace(name, index);
+            return index;
+        }
+
+        /** Element sequence of one pass through a beamline, expanded on first use
+         *
+         * @param name beamline name
+         * @returns the element indices of the beamline, without its repeat count
+         */
+        std::vector<int> const & line (std::string const & name)
+        {
+            auto const it = m_lines.find(name);
+            if (it != m_lines.end()) { return it->second; }
+
+            if (std::find(m_stack.begin(), m_stack.end(), name) != m_stack.end()) {
+                amrex::Abort("Lattice line " + name + " contains itself");
+            }
+            m_stack.push_back(name);
+
+            amrex::ParmParse pp_line(name);
+            std::vector<std::string> line_elements;
+            pp_line.getarr("elements", line_elements);
+
+            std::vector<int> body;
+            for (std::string const & element_name : line_elements) {
+                append(element_name, true, body);
+            }
+
+            m_stack.pop_back();
+            return m_lines.emplace(name, std::move(body)).first->second;
+        }
+
+        int m_nslice_default; //! default number of slices per element
+        std::vector<KnownElements> m_elements; //! each distinct element, stored once
+        std::map<std::string, int> m_element_index; //! element name to index in m_elements
+        std::map<std::string, std::vector<int>> m_lines; //! expanded beamlines
+        std::vector<std::string> m_stack; //! beamlines in expansion, to detect recursion
+    };
+} // namespace
+
     void ImpactX::initLatticeElementsFromInputs ()
     {
         BL_PROFILE("ImpactX::initLatticeElementsFromInputs");
 
         // make sure the element sequence is empty
         m_lattice.clear();
+        m_lattice_repeat = 1;
 
         // Parse the lattice elements
         amrex::ParmParse pp_lattice("lattice");
@@ -38,72 +314,45 @@ namespace impactx
         int nslice_default = 1;
         pp_lattice.query("nslice", nslice_default);
 
-        // Loop through lattice elements
-        for (std::string const & element_name : lattice_elements) {
-            // Check the element type
-            amrex::ParmParse pp_element(element_name);
-            std::string element_type;
-            pp_element.get("type", element_type);
+        // Optional global aperture, checked after every slice step
+        m_aperture.reset();
+        amrex::ParmParse pp_aperture("lattice.aperture");
+        if (pp_aperture.contains("xmax") || pp_aperture.contains("ymax")) {
+            m_aperture = read_aperture(pp_aperture);
+        }
+
+        // Expand named beamlines into a sequence of element indices
+        BeamlineExpansion expansion(nslice_default);
+        std::vector<int> sequence;
 
-            // Initialize the corresponding element according to its type
-            if (element_type == "quad") {
-                amrex::Real ds, k;
-                int nslice = nslice_default;
-                pp_element.get("ds", ds);
-                pp_element.get("k", k);
-                pp_element.queryAdd("nslice", nslice);
-                m_lattice.emplace_back( Quad(ds, k, nslice) );
-            } else if (element_type == "drift") {
-                amrex::Real ds;
-                int nslice = nslice_default;
-                pp_element.get("ds", ds);
-                pp_element.queryAdd("nslice", nslice);
-                m_lattice.emplace_back( Drift(ds, nslice) );
-            } else if (element_type == "sbend") {
-                amrex::Real ds, rc;
-                int nslice = nslice_default;
-                pp_element.get("ds", ds);
-                pp_element.get("rc", rc);
-                pp_element.queryAdd("nslice", nslice);
-                m_lattice.emplace_back( Sbend(ds, rc, nslice) );
-            } else if (element_type == "dipedge") {
-                amrex::Real psi, rc, g, K2;
-                pp_element.get("psi", psi);
-                pp_element.get("rc", rc);
-                pp_element.get("g", g);
-                pp_element.get("K2", K2);
-                m_lattice.emplace_back( DipEdge(psi, rc, g, K2) );
-            } else if (element_type == "constf") {
-                amrex::Real ds, kx, ky, kt;
-                int nslice = nslice_default;
-                pp_element.get("ds", ds);
-                pp_element.get("kx", kx);
-                pp_element.get("ky", ky);
-                pp_element.get("kt", kt);
-                pp_element.queryAdd("nslice", nslice);
-                m_lattice.emplace_back( ConstF(ds, kx, ky, kt, nslice) );
-            } else if (element_type == "shortrf") {
-                amrex::Real V, k;
-                pp_element.get("V", V);
-                pp_element.get("k", k);
-                m_lattice.emplace_back( ShortRF(V, k) );
-            } else if (element_type == "multipole") {
-                int m;
-                amrex::Real k_normal, k_skew;
-                pp_element.get("multipole", m);
-                pp_element.get("k_normal", k_normal);
-                pp_element.get("k_skew", k_skew);
-                m_lattice.emplace_back( Multipole(m, k_normal, k_skew) );
-            } else if (element_type == "nonlinear_lens") {
-                amrex::Real knll, cnll;
-                pp_element.get("knll", knll);
-                pp_element.get("cnll", cnll);
-                m_lattice.emplace_back( NonlinearLens(knll, cnll) );
-            } else {
-                amrex::Abort("Unknown type for lattice element " + element_name + ": " + element_type);
+        // A single repeated top-level beamline, e.g., the cells of a ring, is
+        // stored once and tracked as repeated lattice periods; nested beamlines
+        // are always expanded
+        bool const single_line = lattice_elements.size() == 1 &&
+            BeamlineExpansion::is_line(
+                lattice_elements[0].substr(lattice_elements[0][0] == '-' ? 1 : 0));
+        if (single_line) {
+            std::string const & line_name = lattice_elements[0];
+            m_lattice_repeat = BeamlineExpansion::line_repeat(
+                line_name.substr(line_name[0] == '-' ? 1 : 0));
+            expansion.append(line_name, false, sequence);
+        } else {
+            for (std::string const & element_name : lattice_elements) {
+                expansion.append(element_name, true, sequence);
             }
         }
 
-        amrex::Print() << "Initialized element list" << std::endl;
+        // Copy the elements of the sequence into the lattice
+        std::vector<KnownElements> const & elements = expansion.elements();
+        for (int const index : sequence) {
+            m_lattice.push_back(elements[index]);
+        }
+
+        amrex::Print() << "Initialized element list of " << m_lattice.size() << " elements ("
+                       << elements.size() << " distinct)";
+        if (m_lattice_repeat > 1) {
+            amrex::Print() << ", repeated " << m_lattice_repeat << " times";
+        }
+        amrex::Print() << std::endl;
     }
 } // namespace impactx
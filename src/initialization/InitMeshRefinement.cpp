@@ -16,7 +16,10 @@
 #include <AMReX_REAL.H>
 #include <AMReX_Utility.H>
 
+#include <algorithm>
+#include <array>
 #include <string>
+#include <tuple>
 #include <vector>
 
 
@@ -68,6 +71,14 @@ namespace impactx
 
         m_rho.emplace(lev,
                       amrex::MultiFab{amrex::convert(cba, rho_nodal_flag), dm, num_components_rho, num_guards_rho, tag("rho")});
+
+        // potential (phi) and space charge field meshes, on the same nodes:
+        // the field is gathered from the same guard cells as rho is deposited to
+        int const num_components_field = 3;
+        m_phi.emplace(lev,
+                      amrex::MultiFab{amrex::convert(cba, rho_nodal_flag), dm, num_components_rho, num_guards_rho, tag("phi")});
+        m_space_charge_field.emplace(lev,
+                      amrex::MultiFab{amrex::convert(cba, rho_nodal_flag), dm, num_components_field, num_guards_rho, tag("space_charge_field")});
     }
 
     /** Make a new level using provided BoxArray and DistributionMapping and fill
@@ -101,26 +112,74 @@ namespace impactx
     void ImpactX::ClearLevel (int lev)
     {
         m_rho.erase(lev);
+        m_phi.erase(lev);
+        m_space_charge_field.erase(lev);
     }
 
-    void ImpactX::ResizeMesh ()
+    bool ImpactX::ResizeMesh (bool const keep_if_fits)
+    {
+        // Extract the min and max of the particle positions
+        return ResizeMesh(m_particle_container->MinAndMaxPositions(), keep_if_fits);
+    }
+
+    bool ImpactX::ResizeMesh (
+        std::tuple<amrex::ParticleReal, amrex::ParticleReal, amrex::ParticleReal,
+                   amrex::ParticleReal, amrex::ParticleReal, amrex::ParticleReal> const & extent,
+        bool const keep_if_fits)
     {
         BL_PROFILE("ImpactX::ResizeMesh");
 
-        // Extract the min and max of the particle positions
-        auto const [x_min, y_min, z_min, x_max, y_max, z_max] = m_particle_container->MinAndMaxPositions();
-        // Resize the domain size
-        // The box is expanded slightly beyond the min and max of particles.
-        // This controlled by the variable `frac` below.
+        auto const [x_min, y_min, z_min, x_max, y_max, z_max] = extent;
+        std::array<amrex::Real, 3> const p_min = {x_min, y_min, z_min};
+        std::array<amrex::Real, 3> const p_max = {x_max, y_max, z_max};
+
+        // The box is expanded slightly beyond the min and max of particles,
+        // by a fraction `frac` of their extent, but by at least one cell: the
+        // shape factors of particles one cell inside of the domain stay on its
+        // nodes, so no charge is deposited on guard nodes outside of it.
         const amrex::Real frac=0.1;
+        amrex::Geometry const & gm = Geom(0);
+        std::array<amrex::Real, 3> margin;
+        for (int d = 0; d < AMREX_SPACEDIM; ++d)
+        {
+            int const ncell = gm.Domain().length(d);
+            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(ncell > 2,
+                "ResizeMesh: the mesh needs at least 3 cells in each direction!");
+            margin[d] = std::max(frac, amrex::Real(1.0) / (ncell - 2)) * (p_max[d] - p_min[d]);
+        }
+
+        // Keep the domain while all particles stay one cell inside of it and
+        // its cells are at most a relative tolerance larger than the cells of
+        // the resized domain. Then the particles need no global redistribution
+        // and the Green's function of the Poisson solver is reused.
+        amrex::Real const tolerance = m_mesh_resize_tolerance;
+        if (keep_if_fits && tolerance > 0.0)
+        {
+            bool fits = true;
+            for (int d = 0; d < AMREX_SPACEDIM; ++d)
+            {
+                amrex::Real const dx = gm.CellSize(d);
+                amrex::Real const dx_resized = (p_max[d] - p_min[d] + 2.0 * margin[d]) / gm.Domain().length(d);
+                fits = fits &&
+                       p_min[d] >= gm.ProbLo(d) + dx &&
+                       p_max[d] <= gm.ProbHi(d) - dx &&
+                       dx <= (1.0 + tolerance) * dx_resized;
+            }
+            if (fits) {
+                return false;
+            }
+        }
+
+        // Resize the domain size
         amrex::RealBox rb(
-            {x_min-frac*(x_max-x_min), y_min-frac*(y_max-y_min), z_min-frac*(z_max-z_min)}, // Low bound
-            {x_max+frac*(x_max-x_min), y_max+frac*(y_max-y_min), z_max+frac*(z_max-z_min)}); // High bound
+            {x_min-margin[0], y_min-margin[1], z_min-margin[2]}, // Low bound
+            {x_max+margin[0], y_max+margin[1], z_max+margin[2]}); // High bound
         amrex::Geometry::ResetDefaultProbDomain(rb);
         for (int lev = 0; lev <= this->max_level; ++lev) {
             amrex::Geometry g = Geom(lev);
             g.ProbDomain(rb);
             amrex::AmrMesh::SetGeometry(lev, g);
         }
+        return true;
     }
 } // namespace impactx
@@ -11,16 +11,21 @@
 
 #include "initialization/InitAMReX.H"
 
+#include <AMReX_AmrCore.H>
 #include <AMReX_Array.H>
+#include <AMReX_BLassert.H>
 #include <AMReX_Box.H>
 #include <AMReX_CoordSys.H>
 #include <AMReX_Geometry.H>
 #include <AMReX_IntVect.H>
 #include <AMReX_ParallelDescriptor.H>
+#include <AMReX_ParmParse.H>
 #include <AMReX_RealBox.H>
 #include <AMReX_SPACE.H>
+#include <AMReX_Vector.H>
 
 #include <stdexcept>
+#include <string>
 
 
 namespace impactx::initialization
@@ -46,4 +51,39 @@ namespace impactx::initialization
 
         return {geom, amr_info};
     }
+
+    void
+    set_n_cell (amrex::AmrCore & amr_core)
+    {
+        amrex::ParmParse pp_amr("amr");
+        amrex::Vector<int> n_cell;
+        if (!pp_amr.queryarr("n_cell", n_cell)) {
+            return;
+        }
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(n_cell.size() == AMREX_SPACEDIM,
+            "amr.n_cell must have one number of cells per direction!");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(amr_core.maxLevel() == 0,
+            "amr.n_cell: mesh refinement is not yet supported!");
+
+        amrex::IntVect const & blocking_factor = amr_core.blockingFactor(0);
+        for (int d = 0; d < AMREX_SPACEDIM; ++d)
+        {
+            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+                n_cell[d] > 0 && n_cell[d] % blocking_factor[d] == 0,
+                "amr.n_cell must be a positive multiple of the blocking factor ("
+                + std::to_string(blocking_factor[d]) + ")!");
+        }
+
+        // keep the physical domain, which is resized to the beam before each solve
+        amrex::Geometry const & old_geom = amr_core.Geom(0);
+        amrex::Box const domain(amrex::IntVect(0), amrex::IntVect(n_cell) - amrex::IntVect(1));
+        amrex::Geometry const geom(domain, old_geom.ProbDomain(), old_geom.Coord(), old_geom.isPeriodic());
+        amr_core.SetGeometry(0, geom);
+
+        // split along x into at most one box per MPI rank
+        int const nprocs = amrex::ParallelDescriptor::NProcs();
+        int const num_blocks_x = n_cell[0] / blocking_factor[0];
+        int const max_grid_size_x = blocking_factor[0] * ((num_blocks_x + nprocs - 1) / nprocs);
+        amr_core.SetMaxGridSize(amrex::IntVect(AMREX_D_DECL(max_grid_size_x, n_cell[1], n_cell[2])));
+    }
 } // namespace impactx::initialization
@@ -9,6 +9,7 @@
  */
 #include "InitParser.H"
 
+#include <AMReX_Config.H>
 #include <AMReX_ParmParse.H>
 
 namespace impactx::initialization
@@ -22,5 +23,17 @@ namespace impactx::initialization
         bool abort_on_out_of_gpu_memory = true; // AMReX' default: false
         pp_amrex.query("abort_on_out_of_gpu_memory", abort_on_out_of_gpu_memory);
         pp_amrex.add("abort_on_out_of_gpu_memory", abort_on_out_of_gpu_memory);
+
+        // https://amrex-codes.github.io/amrex/docs_html/Particle.html
+        //   tile particle boxes, so that OpenMP threads on CPU can share
+        //   the particles of a box
+        amrex::ParmParse pp_particles("particles");
+#if defined(AMREX_USE_OMP) && !defined(AMREX_USE_GPU)
+        bool do_tiling = true; // AMReX' default: false
+#else
+        bool do_tiling = false;
+#endif
+        pp_particles.query("do_tiling", do_tiling);
+        pp_particles.add("do_tiling", do_tiling);
     }
 } // namespace impactx
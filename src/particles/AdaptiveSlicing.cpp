@@ -0,0 +1,137 @@
+/* Copyright 2022 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl, Chad Mitchell
+ * License: BSD-3-Clause-LBNL
+ */
+#include "AdaptiveSlicing.H"
+
+#include <AMReX_BLassert.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_Print.H>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+
+namespace impactx
+{
+namespace detail
+{
+    /** Check if the number of slices of an element type can be changed */
+    template <typename T, typename = void>
+    struct has_set_nslice : std::false_type {};
+
+    template <typename T>
+    struct has_set_nslice<T, std::void_t<decltype(
+        std::declval<T &>().set_nslice(1)
+    )>> : std::true_type {};
+} // namespace detail
+
+    std::list<KnownElements>
+    AdaptiveSlicing (std::list<KnownElements> const & lattice,
+                     RefPart const & ref_part,
+                     envelope::CovarianceMatrix const & cm,
+                     amrex::Real tolerance,
+                     int max_nslice)
+    {
+        BL_PROFILE("impactx::AdaptiveSlicing");
+
+        using namespace amrex::literals; // for _rt and _prt
+
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(tolerance > 0.0_rt,
+            "AdaptiveSlicing: tolerance must be positive!");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(max_nslice >= 1,
+            "AdaptiveSlicing: max_nslice must be at least 1!");
+
+        // transport the beam through a prepared slice and add the relative
+        // change of its rms sizes in x and y to the total variation
+        RefPart ref = ref_part;
+        envelope::CovarianceMatrix sigma = cm;
+        auto const transport_slice = [&ref, &sigma](auto & element, RefPart const & entry,
+                                                    amrex::Real variation[2]){
+            prepare_slice(element, ref, entry);
+            envelope::CovarianceMatrix const next =
+                envelope::transport(envelope::linear_map(element, ref), sigma);
+            for (int d = 0; d < 2; ++d)
+            {
+                int const i = 2*d + 1;
+                amrex::Real const size = std::sqrt(sigma(i, i));
+                if (size > 0.0_rt) {
+                    variation[d] += std::abs(std::sqrt(next(i, i)) - size) / size;
+                }
+            }
+            element(ref);
+            sigma = next;
+        };
+
+        std::list<KnownElements> sliced;
+        for (auto const & element_variant : lattice)
+        {
+            std::visit([&](auto element){
+                using T = std::decay_t<decltype(element)>;
+                amrex::Real variation[2] = {0.0_rt, 0.0_rt};
+                RefPart const entry = ref;
+
+                if constexpr (detail::has_set_nslice<T>::value)
+                {
+                    if (element.ds() != 0.0_rt)
+                    {
+                        // probe the beam at the finest slicing
+                        T probe = element;
+                        probe.set_nslice(max_nslice);
+                        for (int slice_step = 0; slice_step < max_nslice; ++slice_step)
+                        {
+                            transport_slice(probe, entry, variation);
+                        }
+
+                        amrex::Real const slices = std::ceil(std::max(variation[0], variation[1]) / tolerance);
+                        int const nslice = static_cast<int>(std::clamp(slices, 1.0_rt,
+                                                                       amrex::Real(max_nslice)));
+                        element.set_nslice(nslice);
+                        sliced.emplace_back(element);
+                        return;
+                    }
+                }
+
+                // keep the slicing of elements without length
+                for (int slice_step = 0; slice_step < element.nslice(); ++slice_step)
+                {
+                    transport_slice(element, entry, variation);
+                }
+                sliced.push_back(element_variant);
+            }, element_variant);
+        }
+
+        return sliced;
+    }
+
+    void
+    PrintSlicing (std::list<KnownElements> const & lattice,
+                  std::string const & file_name)
+    {
+        std::ostringstream ss;
+        ss << "element name ds nslice\n";
+        int index = 0;
+        for (auto const & element_variant : lattice)
+        {
+            std::visit([&ss, index](auto&& element){
+                if (element.ds() != 0.0) {
+                    ss << index << " " << element.name << " "
+                       << element.ds() << " " << element.nslice() << "\n";
+                }
+            }, element_variant);
+            ++index;
+        }
+
+        amrex::PrintToFile(file_name) << ss.str();
+    }
+
+} // namespace impactx
@@ -8,11 +8,16 @@
  * License: BSD-3-Clause-LBNL
  */
 #include "ImpactXParticleContainer.H"
+#include "particles/spacecharge/ShapeFactor.H"
+#include "particles/transformation/ToFixedT.H"
 
 #include <ablastr/particles/DepositCharge.H>
 
 #include <AMReX.H>
 #include <AMReX_AmrParGDB.H>
+#include <AMReX_Array4.H>
+#include <AMReX_GpuAtomic.H>
+#include <AMReX_GpuLaunch.H>
 #include <AMReX_ParallelDescriptor.H>
 #include <AMReX_ParticleTile.H>
 
@@ -21,10 +26,84 @@
 
 namespace impactx
 {
+namespace
+{
+    /** Deposit the charge of the particles of one box at fixed t
+     *
+     * The particles are in x, y, t coordinates at fixed s and are
+     * transformed to fixed t on the fly, without storing them. Their shape
+     * factors must fall on the nodes of the box and its guard nodes.
+     *
+     * @tparam order order of the particle shape, 1, 2 or 3
+     * @param pti the particle box
+     * @param rho charge density on the nodes of the box, with guard nodes
+     * @param plo position of the node of index zero
+     * @param dxi inverse cell size
+     * @param to_t the transformation of the particles to fixed t
+     * @param charge charge of one real particle (C)
+     */
+    template <int order>
+    void
+    deposit_at_fixed_t (ImpactXParticleContainer::iterator & pti,
+                        amrex::Array4<amrex::Real> const & rho,
+                        amrex::GpuArray<amrex::Real, 3> const & plo,
+                        amrex::GpuArray<amrex::Real, 3> const & dxi,
+                        transformation::ToFixedT const & to_t,
+                        amrex::Real const charge)
+    {
+        int const np = pti.numParticles();
+
+        // preparing access to particle data: AoS
+        using PType = ImpactXParticleContainer::ParticleType;
+        auto & aos = pti.GetArrayOfStructs();
+        PType const * const AMREX_RESTRICT aos_ptr = aos().dataPtr();
+
+        // preparing access to particle data: SoA of Reals
+        auto & soa_real = pti.GetStructOfArrays().GetRealData();
+        amrex::ParticleReal const * const AMREX_RESTRICT part_px = soa_real[RealSoA::ux].dataPtr();
+        amrex::ParticleReal const * const AMREX_RESTRICT part_py = soa_real[RealSoA::uy].dataPtr();
+        amrex::ParticleReal const * const AMREX_RESTRICT part_pt = soa_real[RealSoA::pt].dataPtr();
+        amrex::ParticleReal const * const AMREX_RESTRICT part_w = soa_real[RealSoA::w].dataPtr();
+
+        // charge per cell volume
+        amrex::Real const rho_scale = charge * dxi[0] * dxi[1] * dxi[2];
+
+        amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (long i)
+        {
+            PType const & p = aos_ptr[i];
+
+            // position at fixed t
+            amrex::Real x = p.pos(RealAoS::x);
+            amrex::Real y = p.pos(RealAoS::y);
+            amrex::Real z = p.pos(RealAoS::z);
+            amrex::Real px = part_px[i];
+            amrex::Real py = part_py[i];
+            amrex::Real pz = part_pt[i];
+            to_t(x, y, z, px, py, pz);
+
+            amrex::Real sx[order + 1], sy[order + 1], sz[order + 1];
+            int const i0 = spacecharge::shape_factor<order>(sx, (x - plo[0]) * dxi[0]);
+            int const j0 = spacecharge::shape_factor<order>(sy, (y - plo[1]) * dxi[1]);
+            int const k0 = spacecharge::shape_factor<order>(sz, (z - plo[2]) * dxi[2]);
+
+            amrex::Real const q = rho_scale * part_w[i];
+            for (int kz = 0; kz <= order; ++kz) {
+                for (int jy = 0; jy <= order; ++jy) {
+                    for (int ix = 0; ix <= order; ++ix) {
+                        amrex::HostDevice::Atomic::Add(&rho(i0 + ix, j0 + jy, k0 + kz),
+                                                       q * sx[ix] * sy[jy] * sz[kz]);
+                    }
+                }
+            }
+        });
+    }
+} // namespace
+
     void
     ImpactXParticleContainer::DepositCharge (
         std::unordered_map<int, amrex::MultiFab> & rho,
-        amrex::Vector<amrex::IntVect> const & ref_ratio)
+        amrex::Vector<amrex::IntVect> const & ref_ratio,
+        bool const to_fixed_t)
     {
         // loop over refinement levels
         int const nLevel = this->finestLevel();
@@ -36,50 +115,84 @@ namespace impactx
             // get simulation geometry information
             amrex::Geometry const & gm = this->Geom(lev);
 
-            // Loop over particle tiles and deposit charge on each level
+            if (to_fixed_t)
+            {
+                // the node of index zero is at the lower corner of the domain
+                amrex::GpuArray<amrex::Real, 3> const plo = gm.ProbLoArray();
+                amrex::GpuArray<amrex::Real, 3> const dxi = gm.InvCellSizeArray();
+                transformation::ToFixedT const to_t(this->GetRefParticle().pt);
+
+                // charge of one real particle, in C
+                amrex::ParticleReal const charge = this->GetRefParticle().charge;
+
+                int const shape = m_particle_shape.value();
+
+                using ParIt = ImpactXParticleContainer::iterator;
 #ifdef AMREX_USE_OMP
 #pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
 #endif
+                for (ParIt pti(*this, lev); pti.isValid(); ++pti)
+                {
+                    amrex::Array4<amrex::Real> const rho_arr = rho_at_level.array(pti);
+
+                    if (shape == 1) {
+                        deposit_at_fixed_t<1>(pti, rho_arr, plo, dxi, to_t, charge);
+                    } else if (shape == 2) {
+                        deposit_at_fixed_t<2>(pti, rho_arr, plo, dxi, to_t, charge);
+                    } else if (shape == 3) {
+                        deposit_at_fixed_t<3>(pti, rho_arr, plo, dxi, to_t, charge);
+                    } else {
+                        amrex::Abort("DepositCharge: algo.particle_shape must be 1, 2 or 3!");
+                    }
+                }
+            }
+            else
             {
-                amrex::FArrayBox local_rho_fab;
-
-                using ParIt = ImpactXParticleContainer::iterator;
-                for (ParIt pti(*this, lev); pti.isValid(); ++pti) {
-                    // preparing access to particle data: SoA of Reals
-                    auto & AMREX_RESTRICT soa_real = pti.GetStructOfArrays().GetRealData();
-                    // after https://github.com/ECP-WarpX/WarpX/pull/2838 add const:
-                    auto const wp = soa_real[RealSoA::w];
-                    int const * const AMREX_RESTRICT ion_lev = nullptr;
-
-                    // physical lower corner of the current box
-                    //   Note that this includes guard cells since it is after tilebox.grow
-                    amrex::Box tilebox = pti.tilebox();
-                    tilebox.grow(rho_at_level.nGrowVect());
-                    amrex::RealBox const grid_box{tilebox, gm.CellSize(), gm.ProbLo()};
-                    amrex::Real const * const AMREX_RESTRICT xyzmin_ptr = grid_box.lo();
-                    std::array<amrex::Real, 3> const xyzmin = {xyzmin_ptr[0], xyzmin_ptr[1], xyzmin_ptr[2]};
-
-                    // mesh-refinement: for when we do not deposit on the same level
-                    // note: would need to communicate the deposited-to boxes afterwards
-                    //int const depos_lev = lev;
-                    // mesh refinement ratio between lev and depos_lev
-                    //auto const rel_ref_ratio = ref_ratio.at(depos_lev) / ref_ratio.at(lev);
-                    amrex::ignore_unused(ref_ratio);
-
-                    amrex::ParticleReal const q_e = 1.60217662e-19;  // TODO move out
-                    amrex::ParticleReal const charge = q_e;
-
-                    // cell size of the mesh to deposit to
-                    std::array<amrex::Real, 3> const & AMREX_RESTRICT dx = {gm.CellSize(0), gm.CellSize(1), gm.CellSize(2)};
-
-                    // RZ modes (unused)
-                    int const n_rz_azimuthal_modes = 0;
-
-                    ablastr::particles::deposit_charge<ImpactXParticleContainer>
-                            (pti, wp, charge, ion_lev, &rho_at_level,
-                             local_rho_fab,
-                             m_particle_shape.value(),
-                             dx, xyzmin, n_rz_azimuthal_modes);
+                // Loop over particle tiles and deposit charge on each level
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+                {
+                    amrex::FArrayBox local_rho_fab;
+
+                    using ParIt = ImpactXParticleContainer::iterator;
+                    for (ParIt pti(*this, lev); pti.isValid(); ++pti) {
+                        // preparing access to particle data: SoA of Reals
+                        auto & AMREX_RESTRICT soa_real = pti.GetStructOfArrays().GetRealData();
+                        // after https://github.com/ECP-WarpX/WarpX/pull/2838 add const:
+                        auto const wp = soa_real[RealSoA::w];
+                        int const * const AMREX_RESTRICT ion_lev = nullptr;
+
+                        // physical lower corner of the current box
+                        //   Note that this includes guard cells since it is after tilebox.grow
+                        amrex::Box tilebox = pti.tilebox();
+                        tilebox.grow(rho_at_level.nGrowVect());
+                        amrex::RealBox const grid_box{tilebox, gm.CellSize(), gm.ProbLo()};
+                        amrex::Real const * const AMREX_RESTRICT xyzmin_ptr = grid_box.lo();
+                        std::array<amrex::Real, 3> const xyzmin = {xyzmin_ptr[0], xyzmin_ptr[1], xyzmin_ptr[2]};
+
+                        // mesh-refinement: for when we do not deposit on the same level
+                        // note: would need to communicate the deposited-to boxes afterwards
+                        //int const depos_lev = lev;
+                        // mesh refinement ratio between lev and depos_lev
+                        //auto const rel_ref_ratio = ref_ratio.at(depos_lev) / ref_ratio.at(lev);
+                        amrex::ignore_unused(ref_ratio);
+
+                        // charge of one real particle, in C
+                        amrex::ParticleReal const charge = this->GetRefParticle().charge;
+
+                        // cell size of the mesh to deposit to
+                        std::array<amrex::Real, 3> const & AMREX_RESTRICT dx = {gm.CellSize(0), gm.CellSize(1), gm.CellSize(2)};
+
+                        // RZ modes (unused)
+                        int const n_rz_azimuthal_modes = 0;
+
+                        ablastr::particles::deposit_charge<ImpactXParticleContainer>
+                                (pti, wp, charge, ion_lev, &rho_at_level,
+                                 local_rho_fab,
+                                 m_particle_shape.value(),
+                                 dx, xyzmin, n_rz_azimuthal_modes);
+                    }
                 }
             }
 
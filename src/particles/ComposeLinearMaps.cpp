@@ -0,0 +1,136 @@
+/* Copyright 2022 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl
+ * License: BSD-3-Clause-LBNL
+ */
+#include "ComposeLinearMaps.H"
+#include "particles/TransportMap.H"
+
+#include <AMReX_BLassert.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_REAL.H>
+
+#include <cmath>
+#include <complex>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+
+namespace impactx
+{
+namespace detail
+{
+    /** Check if an element type provides a linear transport map */
+    template <typename T, typename = void>
+    struct has_transport_map : std::false_type {};
+
+    template <typename T>
+    struct has_transport_map<T, std::void_t<decltype(
+        std::declval<T const &>().transport_map()
+    )>> : std::true_type {};
+} // namespace detail
+
+    std::list<KnownElements>
+    ComposeLinearMaps (std::list<KnownElements> const & lattice,
+                       RefPart const & ref_part,
+                       bool space_charge)
+    {
+        BL_PROFILE("impactx::ComposeLinearMaps");
+
+        using namespace amrex::literals; // for _rt and _prt
+        using Complex = std::complex<amrex::Real>;
+
+        // an element can be part of a linear map if it is linear and needs
+        // no space charge step per slice
+        auto const is_composable = [space_charge](KnownElements const & element_variant){
+            return std::visit([space_charge](auto&& element){
+                using T = std::decay_t<decltype(element)>;
+                return detail::has_transport_map<T>::value &&
+                       !(space_charge && element.ds() != 0.0_rt);
+            }, element_variant);
+        };
+
+        // push the reference particle through all slices of an element and
+        // compose the transfer matrices of all slices
+        auto const push_element = [](KnownElements const & element_variant,
+                                     RefPart & ref, Map6x6 & R){
+            std::visit([&ref, &R](auto element){
+                using T = std::decay_t<decltype(element)>;
+                RefPart const entry = ref;
+                for (int slice_step = 0; slice_step < element.nslice(); ++slice_step)
+                {
+                    prepare_slice(element, ref, entry);
+                    if constexpr (detail::has_transport_map<T>::value) {
+                        R = compose(element.transport_map(), R);
+                    }
+                    element(ref);
+                }
+            }, element_variant);
+        };
+
+        std::list<KnownElements> composed;
+        RefPart ref = ref_part;
+        Map6x6 R = identity_map();
+
+        auto element_it = lattice.cbegin();
+        while (element_it != lattice.cend())
+        {
+            if (!is_composable(*element_it))
+            {
+                composed.push_back(*element_it);
+                push_element(*element_it, ref, R);
+                ++element_it;
+                continue;
+            }
+
+            // collect a run of linear elements
+            auto const run_begin = element_it;
+            RefPart const ref_in = ref;
+            R = identity_map();
+            amrex::Real ds = 0.0_rt;
+            int nsteps = 0;
+            while (element_it != lattice.cend() && is_composable(*element_it))
+            {
+                push_element(*element_it, ref, R);
+                std::visit([&ds, &nsteps](auto&& element){
+                    ds += element.ds();
+                    nsteps += element.nslice();
+                }, *element_it);
+                ++element_it;
+            }
+
+            // nothing to gain for a single slice step
+            if (nsteps == 1)
+            {
+                composed.push_back(*run_begin);
+                continue;
+            }
+
+            // reference orbit: bending angle and normalized displacement in
+            // the x-z plane, with the complex momentum q = pz + i*px
+            Complex const q_in(ref_in.pz, ref_in.px);
+            Complex const q_out(ref.pz, ref.px);
+            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(std::abs(q_in) > 0.0_rt,
+                "ComposeLinearMaps: reference particle has no momentum in the x-z plane");
+
+            Complex const rotation = q_out / q_in;
+            amrex::Real const theta = std::atan2(-rotation.imag(), rotation.real());
+
+            amrex::Real const pabs = std::sqrt(std::pow(ref_in.pt, 2) - 1.0_rt);
+            Complex const displacement(ref.z - ref_in.z, ref.x - ref_in.x);
+            Complex const displacement_n = displacement * pabs / q_in;
+
+            composed.emplace_back(
+                LinearMap(R, ds, theta, displacement_n.real(), displacement_n.imag())
+            );
+        }
+
+        return composed;
+    }
+
+} // namespace impactx
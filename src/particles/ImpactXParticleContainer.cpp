@@ -8,16 +8,23 @@
  * License: BSD-3-Clause-LBNL
  */
 #include "ImpactXParticleContainer.H"
+#include "particles/transformation/ToFixedT.H"
 
+#include <ablastr/particles/IndexHandling.H>
 #include <ablastr/particles/ParticleMoments.H>
 
 #include <AMReX.H>
 #include <AMReX_AmrCore.H>
 #include <AMReX_AmrParGDB.H>
+#include <AMReX_GpuDevice.H>
+#include <AMReX_Math.H>
 #include <AMReX_ParallelDescriptor.H>
 #include <AMReX_ParmParse.H>
 #include <AMReX_ParticleTile.H>
+#include <AMReX_ParticleUtil.H>
+#include <AMReX_Reduce.H>
 
+#include <cmath>
 #include <stdexcept>
 
 
@@ -109,8 +116,11 @@ namespace impactx
         pinned_tile.push_back_real(RealSoA::uy, py);
         pinned_tile.push_back_real(RealSoA::pt, pz);
         pinned_tile.push_back_real(RealSoA::m_qm, np, qm);
-        amrex::ParticleReal const q_e = 1.60217662e-19;  // TODO move out
-        pinned_tile.push_back_real(RealSoA::w, np, bchchg/q_e/np);
+        // weight: number of real particles per macro particle
+        amrex::ParticleReal const charge = std::abs(m_refpart.charge);
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(charge != 0.0,
+            "AddNParticles: Reference particle charge not yet set!");
+        pinned_tile.push_back_real(RealSoA::w, np, std::abs(bchchg)/charge/np);
 
         /* Redistributes particles to their respective tiles (spatial bucket
          * sort per box over MPI ranks)
@@ -159,4 +169,160 @@ namespace impactx
             ImpactXParticleContainer, RealSoA::w
         >(*this);
     }
+
+    amrex::Real
+    ImpactXParticleContainer::TotalWeight () const
+    {
+        BL_PROFILE("ImpactXParticleContainer::TotalWeight");
+
+        amrex::ReduceOps<amrex::ReduceOpSum> reduce_ops;
+        amrex::ReduceData<amrex::Real> reduce_data(reduce_ops);
+        using ReduceTuple = typename decltype(reduce_data)::Type;
+
+        // loop over refinement levels
+        int const nLevel = finestLevel();
+        for (int lev = 0; lev <= nLevel; ++lev)
+        {
+            // loop over all particle boxes
+            using ParIt = ImpactXParticleContainer::const_iterator;
+            for (ParIt pti(*this, lev); pti.isValid(); ++pti)
+            {
+                int const np = pti.numParticles();
+                auto const & soa_real = pti.GetStructOfArrays().GetRealData();
+                amrex::ParticleReal const * const AMREX_RESTRICT part_w = soa_real[RealSoA::w].dataPtr();
+
+                reduce_ops.eval(np, reduce_data,
+                    [=] AMREX_GPU_DEVICE (int i) -> ReduceTuple
+                    {
+                        return {amrex::Real(part_w[i])};
+                    });
+            }
+        }
+
+        amrex::Real total_weight = amrex::get<0>(reduce_data.value(reduce_ops));
+        amrex::ParallelDescriptor::ReduceRealSum(total_weight);
+        return total_weight;
+    }
+
+    bool
+    ImpactXParticleContainer::NearOwnBoxes (int const num_cells, bool const to_fixed_t)
+    {
+        BL_PROFILE("ImpactXParticleContainer::NearOwnBoxes");
+
+        transformation::ToFixedT const to_t(m_refpart.pt);
+
+        amrex::ReduceOps<amrex::ReduceOpMax> reduce_ops;
+        amrex::ReduceData<int> reduce_data(reduce_ops);
+        using ReduceTuple = typename decltype(reduce_data)::Type;
+
+        // loop over refinement levels
+        int const nLevel = finestLevel();
+        for (int lev = 0; lev <= nLevel; ++lev)
+        {
+            amrex::Geometry const & gm = Geom(lev);
+            amrex::GpuArray<amrex::Real, 3> const plo = gm.ProbLoArray();
+            amrex::GpuArray<amrex::Real, 3> const dxi = gm.InvCellSizeArray();
+
+            // loop over all particle boxes
+            using ParIt = ImpactXParticleContainer::iterator;
+            for (ParIt pti(*this, lev); pti.isValid(); ++pti)
+            {
+                int const np = pti.numParticles();
+                amrex::Box const box = amrex::grow(pti.validbox(), num_cells);
+                amrex::IntVect const lo = box.smallEnd();
+                amrex::IntVect const hi = box.bigEnd();
+
+                ParticleType const * const AMREX_RESTRICT aos_ptr =
+                    pti.GetArrayOfStructs()().dataPtr();
+
+                auto & soa_real = pti.GetStructOfArrays().GetRealData();
+                amrex::ParticleReal const * const AMREX_RESTRICT part_px = soa_real[RealSoA::ux].dataPtr();
+                amrex::ParticleReal const * const AMREX_RESTRICT part_py = soa_real[RealSoA::uy].dataPtr();
+                amrex::ParticleReal const * const AMREX_RESTRICT part_pt = soa_real[RealSoA::pt].dataPtr();
+
+                reduce_ops.eval(np, reduce_data,
+                    [=] AMREX_GPU_DEVICE (int i) -> ReduceTuple
+                    {
+                        ParticleType const & p = aos_ptr[i];
+                        amrex::Real pos[3] = {p.pos(RealAoS::x), p.pos(RealAoS::y), p.pos(RealAoS::z)};
+                        if (to_fixed_t) {
+                            amrex::Real px = part_px[i];
+                            amrex::Real py = part_py[i];
+                            amrex::Real pt = part_pt[i];
+                            to_t(pos[0], pos[1], pos[2], px, py, pt);
+                        }
+
+                        int outside = 0;
+                        for (int d = 0; d < 3; ++d)
+                        {
+                            int const cell = static_cast<int>(
+                                amrex::Math::floor((pos[d] - plo[d]) * dxi[d]));
+                            outside = outside || cell < lo[d] || cell > hi[d];
+                        }
+                        return {outside};
+                    });
+            }
+        }
+
+        int outside = amrex::get<0>(reduce_data.value(reduce_ops));
+        amrex::ParallelDescriptor::ReduceIntMax(outside);
+        return outside == 0;
+    }
+
+    void
+    ImpactXParticleContainer::RemoveLostParticles (amrex::Real s)
+    {
+        BL_PROFILE("ImpactXParticleContainer::RemoveLostParticles");
+
+        // host-side buffer for the lost particles of a tile
+        using PinnedTile = amrex::ParticleTile<NStructReal, NStructInt, NArrayReal, NArrayInt,
+                amrex::PinnedArenaAllocator>;
+        PinnedTile pinned_tile;
+        pinned_tile.define(NumRuntimeRealComps(), NumRuntimeIntComps());
+
+        // loop over refinement levels
+        int const nLevel = finestLevel();
+        for (int lev = 0; lev <= nLevel; ++lev)
+        {
+            // loop over all particle boxes
+            using ParIt = ImpactXParticleContainer::iterator;
+            for (ParIt pti(*this, lev); pti.isValid(); ++pti)
+            {
+                auto& ptile = ParticlesAt(lev, pti);
+                int const np = ptile.numParticles();
+
+                // in-place partition of AoS and SoA: surviving particles first
+                int const np_valid = amrex::partitionParticles(ptile,
+                    [=] AMREX_GPU_DEVICE (auto const & ptd, int i) {
+                        return ptd.m_aos[i].id() > 0;
+                    });
+                int const np_lost = np - np_valid;
+                if (np_lost == 0) { continue; }
+
+                // copy the lost particles at the end of the tile device-to-host
+                pinned_tile.resize(np_lost);
+                amrex::copyParticles(pinned_tile, ptile, np_valid, 0, np_lost);
+                amrex::Gpu::streamSynchronize();
+
+                // append to the loss record
+                auto const & aos = pinned_tile.GetArrayOfStructs();
+                auto const & soa_real = pinned_tile.GetStructOfArrays();
+                for (int i = 0; i < np_lost; ++i)
+                {
+                    ParticleType const & p = aos[i];
+                    m_loss_record.id.push_back(ablastr::particles::localIDtoGlobal(-p.id(), p.cpu()));
+                    m_loss_record.x.push_back(p.pos(RealAoS::x));
+                    m_loss_record.y.push_back(p.pos(RealAoS::y));
+                    m_loss_record.t.push_back(p.pos(RealAoS::z));
+                    m_loss_record.px.push_back(soa_real.GetRealData(RealSoA::ux)[i]);
+                    m_loss_record.py.push_back(soa_real.GetRealData(RealSoA::uy)[i]);
+                    m_loss_record.pt.push_back(soa_real.GetRealData(RealSoA::pt)[i]);
+                    m_loss_record.s.push_back(s);
+                }
+
+                // drop the lost particles from the tile
+                ptile.resize(np_valid);
+            } // end loop over all particle boxes
+        } // end mesh-refinement level loop
+    }
 } // namespace impactx
@@ -0,0 +1,280 @@
+/* Copyright 2022 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl, Chad Mitchell
+ * License: BSD-3-Clause-LBNL
+ */
+#include "LinearOptics.H"
+#include "particles/ReferenceOrbit.H"
+#include "particles/TaylorMap.H"
+#include "particles/envelope/Envelope.H"
+
+#include <AMReX_BLassert.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_Math.H>
+#include <AMReX_Print.H>
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace impactx
+{
+namespace
+{
+    constexpr amrex::Real twopi = 2.0 * amrex::Math::pi<amrex::Real>();
+
+    /** Periodic Twiss functions of one transverse plane
+     *
+     * @param M the one-period map
+     * @param a row and column of the position of the plane, 1 for x and 3 for y
+     * @param[out] beta the periodic beta function (m)
+     * @param[out] alpha the periodic alpha function
+     * @returns the sine of the phase advance per period
+     */
+    amrex::Real
+    periodic_twiss (Map6x6 const & M, int const a,
+                    amrex::Real & beta, amrex::Real & alpha)
+    {
+        using namespace amrex::literals; // for _rt and _prt
+
+        amrex::Real const cosmu = 0.5_rt * (M(a, a) + M(a+1, a+1));
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(std::abs(cosmu) < 1.0_rt,
+            std::string("LinearOptics: the motion in ") + (a == 1 ? "x" : "y") +
+            " is not stable, no periodic solution!");
+
+        amrex::Real const sinmu = std::copysign(std::sqrt(1.0_rt - cosmu*cosmu), M(a, a+1));
+        beta = M(a, a+1) / sinmu;
+        alpha = 0.5_rt * (M(a, a) - M(a+1, a+1)) / sinmu;
+        return sinmu;
+    }
+
+    /** Periodic dispersion of one transverse plane, per unit pt
+     *
+     * Solves eta = M eta + M(., 6) in the plane.
+     *
+     * @param M the one-period map
+     * @param a row and column of the position of the plane, 1 for x and 3 for y
+     * @param[out] eta position and momentum of the closed orbit per unit pt
+     */
+    void
+    periodic_dispersion (Map6x6 const & M, int const a, amrex::Real eta[2])
+    {
+        using namespace amrex::literals; // for _rt and _prt
+
+        amrex::Real const det = (1.0_rt - M(a, a)) * (1.0_rt - M(a+1, a+1)) - M(a, a+1) * M(a+1, a);
+        eta[0] = ((1.0_rt - M(a+1, a+1)) * M(a, 6) + M(a, a+1) * M(a+1, 6)) / det;
+        eta[1] = ((1.0_rt - M(a, a)) * M(a+1, 6) + M(a+1, a) * M(a, 6)) / det;
+    }
+
+    /** Propagate the Twiss functions and dispersion of one plane through a slice
+     *
+     * @param R the transfer matrix of the slice
+     * @param a row and column of the position of the plane, 1 for x and 3 for y
+     * @param[in,out] beta the beta function (m)
+     * @param[in,out] alpha the alpha function
+     * @param[in,out] mu the phase advance, in radians
+     * @param[in,out] eta the dispersion and its derivative per unit pt
+     */
+    void
+    propagate (Map6x6 const & R, int const a,
+               amrex::Real & beta, amrex::Real & alpha, amrex::Real & mu,
+               amrex::Real eta[2])
+    {
+        using namespace amrex::literals; // for _rt and _prt
+
+        amrex::Real const R11 = R(a, a);
+        amrex::Real const R12 = R(a, a+1);
+        amrex::Real const R21 = R(a+1, a);
+        amrex::Real const R22 = R(a+1, a+1);
+        amrex::Real const gamma = (1.0_rt + alpha*alpha) / beta;
+
+        // phase advance of the slice, in [0, 2 pi)
+        amrex::Real dmu = std::atan2(R12, R11*beta - R12*alpha);
+        if (dmu < 0.0_rt) { dmu += twopi; }
+        mu += dmu;
+
+        amrex::Real const beta_out = R11*R11*beta - 2.0_rt*R11*R12*alpha + R12*R12*gamma;
+        amrex::Real const alpha_out = -R11*R21*beta + (R11*R22 + R12*R21)*alpha - R12*R22*gamma;
+        beta = beta_out;
+        alpha = alpha_out;
+
+        amrex::Real const eta_out = R11*eta[0] + R12*eta[1] + R(a, 6);
+        amrex::Real const etap_out = R21*eta[0] + R22*eta[1] + R(a+1, 6);
+        eta[0] = eta_out;
+        eta[1] = etap_out;
+    }
+} // namespace
+
+    LinearOptics::LinearOptics (std::list<KnownElements> const & lattice,
+                                RefPart const & ref_part)
+    {
+        BL_PROFILE("impactx::LinearOptics");
+
+        using namespace amrex::literals; // for _rt and _prt
+
+        // the slice maps only depend on the reference energy, so small rounding
+        // in the closure of the reference direction, e.g., of a ring, is fine
+        ReferenceOrbit const ref_orbit(lattice, ref_part);
+        int const nsteps = ref_orbit.num_steps();
+        amrex::Real const exit_pt = ref_orbit.at(nsteps).pt;
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+            std::abs(exit_pt - ref_part.pt) <= 1000 * std::numeric_limits<amrex::Real>::epsilon() * std::abs(ref_part.pt),
+            "LinearOptics: the reference energy changes over the lattice period!");
+
+        // transfer matrices of all slices and of the period
+        std::vector<Map6x6> slice_maps;
+        slice_maps.reserve(nsteps);
+        m_one_period_map = identity_map();
+        for (int step = 0; step < nsteps; ++step)
+        {
+            slice_maps.push_back(envelope::linear_map(ref_orbit.element(step), ref_orbit.at(step)));
+            m_one_period_map = compose(slice_maps.back(), m_one_period_map);
+        }
+        Map6x6 const & M = m_one_period_map;
+
+        // periodic solution at the entry of the period
+        amrex::Real beta[2], alpha[2], sinmu[2], eta[2][2];
+        amrex::Real mu[2] = {0.0_rt, 0.0_rt};
+        for (int d = 0; d < 2; ++d)
+        {
+            sinmu[d] = periodic_twiss(M, 2*d + 1, beta[d], alpha[d]);
+            periodic_dispersion(M, 2*d + 1, eta[d]);
+        }
+        amrex::Real const eta_pt[tpsa::nvar] = {eta[0][0], eta[0][1], eta[1][0], eta[1][1],
+                                                0.0_rt, 1.0_rt};
+
+        // lattice functions at all element and slice boundaries, with the
+        // dispersion converted from per unit pt to per unit delta
+        amrex::Real const beta0 = ref_part.beta();
+        auto const add_row = [&](int const step)
+        {
+            LatticeFunctions row;
+            row.step = step;
+            row.s = ref_orbit.at(step).s;
+            row.beta_x = beta[0];
+            row.alpha_x = alpha[0];
+            row.beta_y = beta[1];
+            row.alpha_y = alpha[1];
+            row.dispersion_x = -beta0 * eta[0][0];
+            row.dispersion_px = -beta0 * eta[0][1];
+            row.dispersion_y = -beta0 * eta[1][0];
+            row.dispersion_py = -beta0 * eta[1][1];
+            row.mu_x = mu[0] / twopi;
+            row.mu_y = mu[1] / twopi;
+            m_table.push_back(row);
+        };
+        m_table.reserve(nsteps + 1);
+        add_row(0);
+        for (int step = 0; step < nsteps; ++step)
+        {
+            for (int d = 0; d < 2; ++d)
+            {
+                propagate(slice_maps[step], 2*d + 1, beta[d], alpha[d], mu[d], eta[d]);
+            }
+            add_row(step + 1);
+        }
+
+        // chromaticity: the derivative of the linear map around the closed orbit
+        // (eta_x, eta_px, eta_y, eta_py, 0, 1) pt with respect to pt, from the
+        // second-order terms of the one-period map
+        Map6x6 dM{};
+        for (int i = 1; i <= 6; ++i) {
+            for (int j = 1; j <= 6; ++j) {
+                dM(i, j) = 0.0_rt;
+            }
+        }
+        TaylorMap const second_order(lattice, ref_part, 2);
+        for (TaylorTerm const & term : second_order.terms())
+        {
+            int degree = 0;
+            for (int v = 0; v < tpsa::nvar; ++v) { degree += term.exponent[v]; }
+            if (degree != 2) { continue; }
+
+            // d/dz_j of coef z_j z_k, evaluated on the closed orbit
+            for (int j = 0; j < tpsa::nvar; ++j)
+            {
+                if (term.exponent[j] == 0) { continue; }
+                for (int k = 0; k < tpsa::nvar; ++k)
+                {
+                    int const e = term.exponent[k] - (k == j ? 1 : 0);
+                    if (e == 1) {
+                        dM(term.component + 1, j + 1) += term.coef * term.exponent[j] * eta_pt[k];
+                    }
+                }
+            }
+        }
+
+        // d(cos mu)/dpt = dtr/dpt / 2 = -sin mu dmu/dpt
+        for (int d = 0; d < 2; ++d)
+        {
+            int const a = 2*d + 1;
+            amrex::Real const dtrace = dM(a, a) + dM(a+1, a+1);
+            amrex::Real const dtune_dpt = -dtrace / (2.0_rt * sinmu[d] * twopi);
+            (d == 0 ? m_chromaticity_x : m_chromaticity_y) = -beta0 * dtune_dpt;
+        }
+    }
+
+    Map6x6 const &
+    LinearOptics::one_period_map () const
+    {
+        return m_one_period_map;
+    }
+
+    amrex::Real
+    LinearOptics::tune_x () const
+    {
+        return m_table.back().mu_x;
+    }
+
+    amrex::Real
+    LinearOptics::tune_y () const
+    {
+        return m_table.back().mu_y;
+    }
+
+    amrex::Real
+    LinearOptics::chromaticity_x () const
+    {
+        return m_chromaticity_x;
+    }
+
+    amrex::Real
+    LinearOptics::chromaticity_y () const
+    {
+        return m_chromaticity_y;
+    }
+
+    std::vector<LatticeFunctions> const &
+    LinearOptics::table () const
+    {
+        return m_table;
+    }
+
+    void
+    LinearOptics::Print (std::string const & file_name) const
+    {
+        BL_PROFILE("impactx::LinearOptics::Print");
+
+        std::ostringstream ss;
+        ss.precision(17);
+        ss << linear_optics_header;
+        for (LatticeFunctions const & r : m_table)
+        {
+            ss << r.step << " " << r.s << " "
+               << r.beta_x << " " << r.alpha_x << " " << r.beta_y << " " << r.alpha_y << " "
+               << r.dispersion_x << " " << r.dispersion_px << " "
+               << r.dispersion_y << " " << r.dispersion_py << " "
+               << r.mu_x << " " << r.mu_y << "\n";
+        }
+
+        amrex::PrintToFile(file_name) << ss.str();
+    }
+
+} // namespace impactx
@@ -9,15 +9,45 @@
  */
 #include "Push.H"
 
+#include <AMReX_BLassert.H>
 #include <AMReX_BLProfiler.H>
-#include <AMReX_Extension.H>  // for AMREX_RESTRICT
-#include <AMReX_REAL.H>       // for ParticleReal
+#include <AMReX_Extension.H>      // for AMREX_RESTRICT
+#include <AMReX_GpuAtomic.H>      // for HostDevice::Atomic::Add
+#include <AMReX_GpuContainers.H>  // for Buffer
+#include <AMReX_REAL.H>           // for ParticleReal, Real
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <variant>
 
 
 namespace impactx
 {
 namespace detail
 {
+    /** Check if an element slice marks a particle as lost
+     *
+     * @tparam T_Element This can be a \see Drift, \see Quad, \see Aperture, etc.
+     * @param element the element slice the particle was pushed through
+     * @param x particle position in x after the push
+     * @param y particle position in y after the push
+     * @returns true if the particle is outside of the element aperture
+     */
+    template <typename T_Element>
+    AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+    bool
+    lost_in_element ([[maybe_unused]] T_Element const & element,
+                     [[maybe_unused]] amrex::Real const x,
+                     [[maybe_unused]] amrex::Real const y)
+    {
+        if constexpr (std::is_same_v<T_Element, Aperture>) {
+            return element.lost(x, y);
+        } else {
+            return false;
+        }
+    }
+
     /** Push a single particle through an element
      *
      * Note: we usually would just write a C++ lambda below in ParallelFor. But, due to restrictions
@@ -44,16 +74,23 @@ namespace detail
          * @param part_py the array to the particle momentum (y)
          * @param part_pt the array to the particle momentum (t)
          * @param ref_part the struct containing the reference particle
+         * @param aperture optional global aperture
+         * @param nlost counter of the particles marked as lost, shared by all threads
          */
         PushSingleParticle (T_Element element,
                             PType* AMREX_RESTRICT aos_ptr,
                             amrex::ParticleReal* AMREX_RESTRICT part_px,
                             amrex::ParticleReal* AMREX_RESTRICT part_py,
                             amrex::ParticleReal* AMREX_RESTRICT part_pt,
-                            RefPart ref_part)
+                            RefPart ref_part,
+                            std::optional<Aperture> const & aperture,
+                            int* nlost)
             : m_element(element), m_aos_ptr(aos_ptr),
               m_part_px(part_px), m_part_py(part_py), m_part_pt(part_pt),
-              m_ref_part(ref_part)
+              m_ref_part(ref_part),
+              m_has_aperture(aperture.has_value()),
+              m_aperture(aperture.value_or(Aperture(0.0, 0.0))),
+              m_nlost(nlost)
         {
         }
 
@@ -73,14 +110,37 @@ namespace detail
             // access AoS data such as positions and cpu/id
             PType& AMREX_RESTRICT p = m_aos_ptr[i];
 
+            // particles that are already lost keep their position of loss
+            // until they are removed
+            if (p.id() < 0) { return; }
+
+            amrex::Real x = p.pos(RealAoS::x);
+            amrex::Real y = p.pos(RealAoS::y);
+            amrex::Real t = p.pos(RealAoS::z);
+
             // access SoA Real data
-            amrex::ParticleReal & AMREX_RESTRICT px = m_part_px[i];
-            amrex::ParticleReal & AMREX_RESTRICT py = m_part_py[i];
-            amrex::ParticleReal & AMREX_RESTRICT pt = m_part_pt[i];
+            amrex::Real px = m_part_px[i];
+            amrex::Real py = m_part_py[i];
+            amrex::Real pt = m_part_pt[i];
 
             // push through element
-            m_element(p, px, py, pt, m_ref_part);
+            m_element(x, y, t, px, py, pt, m_ref_part);
 
+            // mark particles outside of the element or global aperture as lost
+            bool const lost = lost_in_element(m_element, x, y) ||
+                              (m_has_aperture && m_aperture.lost(x, y));
+            if (lost) {
+                p.id() = -p.id();
+                amrex::HostDevice::Atomic::Add(m_nlost, 1);
+            }
+
+            // store particle data in the (possibly lower) particle precision
+            p.pos(RealAoS::x) = x;
+            p.pos(RealAoS::y) = y;
+            p.pos(RealAoS::z) = t;
+            m_part_px[i] = px;
+            m_part_py[i] = py;
+            m_part_pt[i] = pt;
         }
 
     private:
@@ -90,11 +150,240 @@ namespace detail
         amrex::ParticleReal* const AMREX_RESTRICT m_part_py;
         amrex::ParticleReal* const AMREX_RESTRICT m_part_pt;
         RefPart const m_ref_part;
+        bool const m_has_aperture;
+        Aperture const m_aperture;
+        int* const m_nlost;
+    };
+
+    /** Call a functor with the currently held element of a lattice element variant
+     *
+     * This is a replacement for std::visit, which cannot be called in device code.
+     *
+     * @tparam I the variant index to compare against
+     * @tparam F a functor (or generic lambda) that can be called with each element type
+     * @param f the functor to call
+     * @param element_variant the element to pass to the functor
+     */
+    template <std::size_t I = 0, typename F>
+    AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+    void
+    visit_element ([[maybe_unused]] F && f,
+                   [[maybe_unused]] KnownElements const & element_variant)
+    {
+        if constexpr (I < std::variant_size_v<KnownElements>) {
+            if (element_variant.index() == I) {
+                f(*std::get_if<I>(&element_variant));
+            } else {
+                visit_element<I + 1>(std::forward<F>(f), element_variant);
+            }
+        }
+    }
+
+    /** Push a single particle through a segment of element slices
+     *
+     * The particle is loaded once, pushed through all slice steps of the
+     * segment in registers and stored once.
+     */
+    struct PushSingleParticleSegment
+    {
+        using PType = ImpactXParticleContainer::ParticleType;
+
+        /** Constructor taking in pointers to particle data
+         *
+         * @param aos_ptr the array-of-struct with position and ids
+         * @param part_px the array to the particle momentum (x)
+         * @param part_py the array to the particle momentum (y)
+         * @param part_pt the array to the particle momentum (t)
+         * @param steps the element of each slice step in the segment
+         * @param ref_parts the reference particle at the entry of each slice step
+         * @param nsteps the number of slice steps in the segment
+         * @param aperture optional global aperture
+         * @param nlost counter of the particles marked as lost, shared by all threads
+         */
+        PushSingleParticleSegment (PType* AMREX_RESTRICT aos_ptr,
+                                   amrex::ParticleReal* AMREX_RESTRICT part_px,
+                                   amrex::ParticleReal* AMREX_RESTRICT part_py,
+                                   amrex::ParticleReal* AMREX_RESTRICT part_pt,
+                                   KnownElements const * AMREX_RESTRICT steps,
+                                   RefPart const * AMREX_RESTRICT ref_parts,
+                                   int nsteps,
+                                   std::optional<Aperture> const & aperture,
+                                   int* nlost)
+            : m_aos_ptr(aos_ptr),
+              m_part_px(part_px), m_part_py(part_py), m_part_pt(part_pt),
+              m_steps(steps), m_ref_parts(ref_parts), m_nsteps(nsteps),
+              m_has_aperture(aperture.has_value()),
+              m_aperture(aperture.value_or(Aperture(0.0, 0.0))),
+              m_nlost(nlost)
+        {
+        }
+
+        PushSingleParticleSegment () = delete;
+        PushSingleParticleSegment (PushSingleParticleSegment const &) = default;
+        PushSingleParticleSegment (PushSingleParticleSegment &&) = default;
+        ~PushSingleParticleSegment () = default;
+
+        /** Push a single particle through all slice steps of the segment
+         *
+         * @param i particle index in the current box
+         */
+        AMREX_GPU_DEVICE AMREX_FORCE_INLINE
+        void
+        operator() (long i) const
+        {
+            // load particle data once, promoted to the compute precision
+            PType& AMREX_RESTRICT p = m_aos_ptr[i];
+
+            // particles that are already lost keep their position of loss
+            // until they are removed
+            if (p.id() < 0) { return; }
+
+            amrex::Real x = p.pos(RealAoS::x);
+            amrex::Real y = p.pos(RealAoS::y);
+            amrex::Real t = p.pos(RealAoS::z);
+            amrex::Real px = m_part_px[i];
+            amrex::Real py = m_part_py[i];
+            amrex::Real pt = m_part_pt[i];
+
+            // push through all slice steps of the segment, until the particle is lost
+            bool lost = false;
+            for (int step = 0; step < m_nsteps && !lost; ++step) {
+                RefPart const ref_part = m_ref_parts[step];
+                visit_element(
+                    [&](auto const & element) {
+                        element(x, y, t, px, py, pt, ref_part);
+                        lost = lost_in_element(element, x, y);
+                    },
+                    m_steps[step]
+                );
+                lost = lost || (m_has_aperture && m_aperture.lost(x, y));
+            }
+            if (lost) {
+                p.id() = -p.id();
+                amrex::HostDevice::Atomic::Add(m_nlost, 1);
+            }
+
+            // store particle data once
+            p.pos(RealAoS::x) = x;
+            p.pos(RealAoS::y) = y;
+            p.pos(RealAoS::z) = t;
+            m_part_px[i] = px;
+            m_part_py[i] = py;
+            m_part_pt[i] = pt;
+        }
+
+    private:
+        PType* const AMREX_RESTRICT m_aos_ptr;
+        amrex::ParticleReal* const AMREX_RESTRICT m_part_px;
+        amrex::ParticleReal* const AMREX_RESTRICT m_part_py;
+        amrex::ParticleReal* const AMREX_RESTRICT m_part_pt;
+        KnownElements const * const AMREX_RESTRICT m_steps;
+        RefPart const * const AMREX_RESTRICT m_ref_parts;
+        int const m_nsteps;
+        bool const m_has_aperture;
+        Aperture const m_aperture;
+        int* const m_nlost;
+    };
+
+    /** Push a single particle with a Taylor map
+     *
+     * The powers of all coordinates up to the map order are tabulated once,
+     * then every term of the map is a product of one power per coordinate.
+     */
+    struct PushSingleParticleTaylorMap
+    {
+        using PType = ImpactXParticleContainer::ParticleType;
+
+        /** Constructor taking in pointers to particle data
+         *
+         * @param aos_ptr the array-of-struct with position and ids
+         * @param part_px the array to the particle momentum (x)
+         * @param part_py the array to the particle momentum (y)
+         * @param part_pt the array to the particle momentum (t)
+         * @param terms the nonzero terms of the map
+         * @param nterms the number of terms
+         * @param order the highest total degree of the map
+         */
+        PushSingleParticleTaylorMap (PType* AMREX_RESTRICT aos_ptr,
+                                     amrex::ParticleReal* AMREX_RESTRICT part_px,
+                                     amrex::ParticleReal* AMREX_RESTRICT part_py,
+                                     amrex::ParticleReal* AMREX_RESTRICT part_pt,
+                                     TaylorTerm const * AMREX_RESTRICT terms,
+                                     int nterms,
+                                     int order)
+            : m_aos_ptr(aos_ptr),
+              m_part_px(part_px), m_part_py(part_py), m_part_pt(part_pt),
+              m_terms(terms), m_nterms(nterms), m_order(order)
+        {
+        }
+
+        PushSingleParticleTaylorMap () = delete;
+        PushSingleParticleTaylorMap (PushSingleParticleTaylorMap const &) = default;
+        PushSingleParticleTaylorMap (PushSingleParticleTaylorMap &&) = default;
+        ~PushSingleParticleTaylorMap () = default;
+
+        /** Push a single particle with the map
+         *
+         * @param i particle index in the current box
+         */
+        AMREX_GPU_DEVICE AMREX_FORCE_INLINE
+        void
+        operator() (long i) const
+        {
+            using namespace amrex::literals; // for _rt and _prt
+
+            // load particle data in the order of the map variables
+            PType& AMREX_RESTRICT p = m_aos_ptr[i];
+            amrex::Real const v[tpsa::nvar] = {
+                p.pos(RealAoS::x), m_part_px[i],
+                p.pos(RealAoS::y), m_part_py[i],
+                p.pos(RealAoS::z), m_part_pt[i]
+            };
+
+            // powers of the coordinates up to the order of the map
+            amrex::Real pw[tpsa::nvar][TaylorMap::max_order + 1];
+            for (int var = 0; var < tpsa::nvar; ++var) {
+                pw[var][0] = 1.0_rt;
+                for (int n = 1; n <= m_order; ++n) {
+                    pw[var][n] = pw[var][n-1] * v[var];
+                }
+            }
+
+            // sum the terms of all components
+            amrex::Real out[tpsa::nvar] = {0.0_rt, 0.0_rt, 0.0_rt, 0.0_rt, 0.0_rt, 0.0_rt};
+            for (int m = 0; m < m_nterms; ++m) {
+                TaylorTerm const & term = m_terms[m];
+                amrex::Real monomial = term.coef;
+                for (int var = 0; var < tpsa::nvar; ++var) {
+                    monomial *= pw[var][term.exponent[var]];
+                }
+                out[term.component] += monomial;
+            }
+
+            // store particle data
+            p.pos(RealAoS::x) = out[0];
+            m_part_px[i] = out[1];
+            p.pos(RealAoS::y) = out[2];
+            m_part_py[i] = out[3];
+            p.pos(RealAoS::z) = out[4];
+            m_part_pt[i] = out[5];
+        }
+
+    private:
+        PType* const AMREX_RESTRICT m_aos_ptr;
+        amrex::ParticleReal* const AMREX_RESTRICT m_part_px;
+        amrex::ParticleReal* const AMREX_RESTRICT m_part_py;
+        amrex::ParticleReal* const AMREX_RESTRICT m_part_pt;
+        TaylorTerm const * const AMREX_RESTRICT m_terms;
+        int const m_nterms;
+        int const m_order;
     };
 } // namespace detail
 
-    void Push (ImpactXParticleContainer & pc,
-               KnownElements const & element_variant)
+    int Push (ImpactXParticleContainer & pc,
+              KnownElements const & element_variant,
+              RefPart const & ref_part,
+              std::optional<Aperture> const & aperture)
     {
         // performance profiling per element
         std::string element_name;
@@ -105,8 +394,9 @@ namespace detail
 
         using namespace amrex::literals; // for _rt and _prt
 
-        // preparing to access reference particle data: RefPart
-        RefPart & ref_part = pc.GetRefParticle();
+        // number of particles marked as lost
+        amrex::Gpu::Buffer<int> nlost({0});
+        int* const nlost_ptr = nlost.data();
 
         // loop over refinement levels
         int const nLevel = pc.finestLevel();
@@ -118,6 +408,9 @@ namespace detail
 
             // loop over all particle boxes
             using ParIt = ImpactXParticleContainer::iterator;
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
             for (ParIt pti(pc, lev); pti.isValid(); ++pti) {
                 const int np = pti.numParticles();
                 //const auto t_lev = pti.GetLevel();
@@ -137,20 +430,119 @@ namespace detail
 
                 // here we just access the element by its respective type
                 std::visit(
-                    [=, &ref_part](auto element) {
+                    [=](auto element) {
                         // push beam particles relative to reference particle
                         detail::PushSingleParticle<decltype(element)> const pushSingleParticle(
-                            element, aos_ptr, part_px, part_py, part_pt, ref_part);
+                            element, aos_ptr, part_px, part_py, part_pt, ref_part,
+                            aperture, nlost_ptr);
                         //   loop over beam particles in the box
                         amrex::ParallelFor(np, pushSingleParticle);
-
-                        // push reference particle in global coordinates
-                        element(ref_part);
                     },
                     element_variant
                 );
             } // end loop over all particle boxes
         } // env mesh-refinement level loop
+
+        return *nlost.copyToHost();
+    }
+
+    int Push (ImpactXParticleContainer & pc,
+              ReferenceOrbit const & ref_orbit,
+              int step,
+              int nsteps,
+              std::optional<Aperture> const & aperture)
+    {
+        BL_PROFILE("impactx::Push::segment");
+
+        if (nsteps == 0) { return 0; }
+
+        // the prepared slice steps of the segment are already on the device
+        int const first_step = step % ref_orbit.num_steps();
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(first_step + nsteps <= ref_orbit.num_steps(),
+                                         "Push: segment must not cross a lattice period!");
+        KnownElements const * const AMREX_RESTRICT steps_ptr =
+            ref_orbit.elements_data() + first_step;
+        RefPart const * const AMREX_RESTRICT ref_parts_ptr =
+            ref_orbit.ref_parts_data() + first_step;
+
+        // number of particles marked as lost
+        amrex::Gpu::Buffer<int> nlost({0});
+        int* const nlost_ptr = nlost.data();
+
+        // loop over refinement levels
+        int const nLevel = pc.finestLevel();
+        for (int lev = 0; lev <= nLevel; ++lev)
+        {
+            // loop over all particle boxes
+            using ParIt = ImpactXParticleContainer::iterator;
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+            for (ParIt pti(pc, lev); pti.isValid(); ++pti) {
+                const int np = pti.numParticles();
+
+                // preparing access to particle data: AoS
+                using PType = ImpactXParticleContainer::ParticleType;
+                auto& aos = pti.GetArrayOfStructs();
+                PType* AMREX_RESTRICT aos_ptr = aos().dataPtr();
+
+                // preparing access to particle data: SoA of Reals
+                auto& soa_real = pti.GetStructOfArrays().GetRealData();
+                amrex::ParticleReal* const AMREX_RESTRICT part_px = soa_real[RealSoA::ux].dataPtr();
+                amrex::ParticleReal* const AMREX_RESTRICT part_py = soa_real[RealSoA::uy].dataPtr();
+                amrex::ParticleReal* const AMREX_RESTRICT part_pt = soa_real[RealSoA::pt].dataPtr();
+
+                // push beam particles relative to reference particle
+                detail::PushSingleParticleSegment const pushSingleParticle(
+                    aos_ptr, part_px, part_py, part_pt,
+                    steps_ptr, ref_parts_ptr, nsteps, aperture, nlost_ptr);
+                //   loop over beam particles in the box
+                amrex::ParallelFor(np, pushSingleParticle);
+            } // end loop over all particle boxes
+        } // env mesh-refinement level loop
+
+        return *nlost.copyToHost();
+    }
+
+    void Push (ImpactXParticleContainer & pc,
+               TaylorMap const & map)
+    {
+        BL_PROFILE("impactx::Push::TaylorMap");
+
+        TaylorTerm const * const AMREX_RESTRICT terms_ptr = map.terms_data();
+        int const nterms = map.num_terms();
+        int const order = map.order();
+
+        // loop over refinement levels
+        int const nLevel = pc.finestLevel();
+        for (int lev = 0; lev <= nLevel; ++lev)
+        {
+            // loop over all particle boxes
+            using ParIt = ImpactXParticleContainer::iterator;
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+            for (ParIt pti(pc, lev); pti.isValid(); ++pti) {
+                const int np = pti.numParticles();
+
+                // preparing access to particle data: AoS
+                using PType = ImpactXParticleContainer::ParticleType;
+                auto& aos = pti.GetArrayOfStructs();
+                PType* AMREX_RESTRICT aos_ptr = aos().dataPtr();
+
+                // preparing access to particle data: SoA of Reals
+                auto& soa_real = pti.GetStructOfArrays().GetRealData();
+                amrex::ParticleReal* const AMREX_RESTRICT part_px = soa_real[RealSoA::ux].dataPtr();
+                amrex::ParticleReal* const AMREX_RESTRICT part_py = soa_real[RealSoA::uy].dataPtr();
+                amrex::ParticleReal* const AMREX_RESTRICT part_pt = soa_real[RealSoA::pt].dataPtr();
+
+                // map beam particles relative to reference particle
+                detail::PushSingleParticleTaylorMap const pushSingleParticle(
+                    aos_ptr, part_px, part_py, part_pt, terms_ptr, nterms, order);
+                //   loop over beam particles in the box
+                amrex::ParallelFor(np, pushSingleParticle);
+            } // end loop over all particle boxes
+        } // env mesh-refinement level loop
     }
 
 } // namespace impactx
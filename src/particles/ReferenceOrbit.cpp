@@ -0,0 +1,120 @@
+/* Copyright 2022 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl
+ * License: BSD-3-Clause-LBNL
+ */
+#include "ReferenceOrbit.H"
+
+#include <AMReX_BLassert.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_REAL.H>
+
+#include <cmath>
+#include <limits>
+#include <variant>
+
+
+namespace impactx
+{
+    ReferenceOrbit::ReferenceOrbit (std::list<KnownElements> const & lattice,
+                                    RefPart const & ref_part)
+    {
+        BL_PROFILE("impactx::ReferenceOrbit");
+
+        RefPart refpart = ref_part;
+        m_ref_parts.push_back(refpart);
+
+        for (auto const & element_variant : lattice)
+        {
+            std::visit([&](auto element){
+                RefPart const entry = refpart;
+                for (int slice_step = 0; slice_step < element.nslice(); ++slice_step)
+                {
+                    // compute the element coefficients for this slice
+                    prepare_slice(element, refpart, entry);
+                    m_elements.push_back(element);
+
+                    // push reference particle in global coordinates
+                    element(refpart);
+                    m_ref_parts.push_back(refpart);
+                }
+            }, element_variant);
+        }
+
+        // copy the slice steps to the device
+        m_elements_d.resize(m_elements.size());
+        m_ref_parts_d.resize(m_ref_parts.size());
+        amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice,
+                              m_elements.begin(), m_elements.end(), m_elements_d.begin());
+        amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice,
+                              m_ref_parts.begin(), m_ref_parts.end(), m_ref_parts_d.begin());
+        amrex::Gpu::streamSynchronize();
+    }
+
+    int
+    ReferenceOrbit::num_steps () const
+    {
+        return m_elements.size();
+    }
+
+    bool
+    ReferenceOrbit::is_periodic () const
+    {
+        // allow for the rounding in the rotations of bends that close a ring
+        RefPart const & entry = m_ref_parts.front();
+        RefPart const & exit = m_ref_parts.back();
+        amrex::Real const tol = 1000 * std::numeric_limits<amrex::Real>::epsilon() *
+                                std::abs(entry.pt);
+        return std::abs(exit.px - entry.px) <= tol && std::abs(exit.py - entry.py) <= tol &&
+               std::abs(exit.pz - entry.pz) <= tol && std::abs(exit.pt - entry.pt) <= tol;
+    }
+
+    RefPart
+    ReferenceOrbit::at (int step) const
+    {
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(step >= 0,
+                                         "ReferenceOrbit: global step out of range!");
+        int const nsteps = num_steps();
+        if (step <= nsteps) { return m_ref_parts[step]; }
+
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(is_periodic(),
+                                         "ReferenceOrbit: global step beyond a non-periodic orbit!");
+
+        // the orbit of later periods is translated by the displacement of one period
+        int const period = step / nsteps;
+        RefPart const & entry = m_ref_parts.front();
+        RefPart const & exit = m_ref_parts.back();
+        RefPart refpart = m_ref_parts[step % nsteps];
+        refpart.s += period * (exit.s - entry.s);
+        refpart.x += period * (exit.x - entry.x);
+        refpart.y += period * (exit.y - entry.y);
+        refpart.z += period * (exit.z - entry.z);
+        refpart.t += period * (exit.t - entry.t);
+        return refpart;
+    }
+
+    KnownElements const &
+    ReferenceOrbit::element (int step) const
+    {
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(step >= 0 && (step < num_steps() || is_periodic()),
+                                         "ReferenceOrbit: global step out of range!");
+        return m_elements[step % num_steps()];
+    }
+
+    KnownElements const *
+    ReferenceOrbit::elements_data () const
+    {
+        return m_elements_d.dataPtr();
+    }
+
+    RefPart const *
+    ReferenceOrbit::ref_parts_data () const
+    {
+        return m_ref_parts_d.dataPtr();
+    }
+
+} // namespace impactx
@@ -0,0 +1,58 @@
+/* Copyright 2022 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl, Chad Mitchell, Ji Qiang
+ * License: BSD-3-Clause-LBNL
+ */
+#include "SpaceChargeAlgo.H"
+
+#include <AMReX.H>
+#include <AMReX_ParmParse.H>
+
+#include <algorithm>
+#include <cctype>
+
+
+namespace impactx
+{
+    SpaceChargeAlgo
+    get_space_charge_algo ()
+    {
+        amrex::ParmParse pp_algo("algo");
+        std::string space_charge = "true";
+        pp_algo.queryAdd("space_charge", space_charge);
+
+        // Python adds booleans as 1 and 0
+        std::transform(space_charge.begin(), space_charge.end(), space_charge.begin(),
+                       [](unsigned char c){ return std::tolower(c); });
+        if (space_charge == "false" || space_charge == "0") {
+            return SpaceChargeAlgo::False;
+        }
+        if (space_charge == "true" || space_charge == "1" || space_charge == "3d") {
+            return SpaceChargeAlgo::ThreeD;
+        }
+        if (space_charge == "2.5d") {
+            return SpaceChargeAlgo::TwoAndAHalfD;
+        }
+        amrex::Abort("algo.space_charge must be false, true, 3D or 2.5D, not " + space_charge);
+        return SpaceChargeAlgo::False;
+    }
+
+    std::string
+    to_string (SpaceChargeAlgo const algo)
+    {
+        switch (algo)
+        {
+            case SpaceChargeAlgo::ThreeD:
+                return "3D";
+            case SpaceChargeAlgo::TwoAndAHalfD:
+                return "2.5D";
+            default:
+                return "false";
+        }
+    }
+
+} // namespace impactx
@@ -0,0 +1,88 @@
+/* Copyright 2022 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl, Chad Mitchell
+ * License: BSD-3-Clause-LBNL
+ */
+#include "SpaceChargeSplitting.H"
+
+#include <AMReX.H>
+#include <AMReX_BLassert.H>
+
+#include <cmath>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+
+namespace impactx
+{
+namespace detail
+{
+    /** Check if the length of an element type can be scaled */
+    template <typename T, typename = void>
+    struct has_scale_length : std::false_type {};
+
+    template <typename T>
+    struct has_scale_length<T, std::void_t<decltype(
+        std::declval<T &>().scale_length(1.0)
+    )>> : std::true_type {};
+} // namespace detail
+
+    SplittingCoefficients
+    SpaceChargeSplitting (int const order)
+    {
+        using namespace amrex::literals; // for _rt and _prt
+
+        if (order == 1) {
+            return {{1.0_rt, 0.0_rt}, {1.0_rt}};
+        }
+        if (order == 2) {
+            return {{0.5_rt, 0.5_rt}, {1.0_rt}};
+        }
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(order == 4,
+            "SpaceChargeSplitting: the order must be 1, 2 or 4!");
+
+        // triple jump of order-2 steps: w1, w0, w1 with 2*w1 + w0 = 1
+        amrex::Real const w1 = 1.0_rt / (2.0_rt - std::cbrt(2.0_rt));
+        amrex::Real const w0 = 1.0_rt - 2.0_rt * w1;
+        return {{0.5_rt*w1, 0.5_rt*(w1 + w0), 0.5_rt*(w0 + w1), 0.5_rt*w1},
+                {w1, w0, w1}};
+    }
+
+    bool
+    has_sub_steps (KnownElements const & element_variant)
+    {
+        return std::visit([](auto && element){
+            using T = std::decay_t<decltype(element)>;
+            return detail::has_scale_length<T>::value;
+        }, element_variant);
+    }
+
+    KnownElements
+    SubStep (KnownElements const & element_variant,
+             amrex::Real const fraction,
+             RefPart const & refpart)
+    {
+        return std::visit([fraction, &refpart](auto element) -> KnownElements {
+            using T = std::decay_t<decltype(element)>;
+            if constexpr (detail::has_scale_length<T>::value)
+            {
+                element.scale_length(fraction);
+                element.prepare(refpart);
+                return element;
+            }
+            else
+            {
+                amrex::Abort(std::string("SubStep: element ") + T::name +
+                             " cannot be split into sub-steps!");
+                return element;
+            }
+        }, element_variant);
+    }
+
+} // namespace impactx
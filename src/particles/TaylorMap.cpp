@@ -0,0 +1,132 @@
+/* Copyright 2022 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl, Chad Mitchell
+ * License: BSD-3-Clause-LBNL
+ */
+#include "TaylorMap.H"
+
+#include <AMReX_BLassert.H>
+#include <AMReX_BLProfiler.H>
+
+#include <string>
+#include <variant>
+
+
+namespace impactx
+{
+namespace
+{
+    /** Push power series through all slices of a lattice period
+     *
+     * @tparam T_Order the highest total degree of the map
+     * @param lattice the lattice elements of one period
+     * @param ref_part the reference particle at the entry of the period
+     * @returns the nonzero terms of the map
+     */
+    template <int T_Order>
+    std::vector<TaylorTerm>
+    extract_terms (std::list<KnownElements> const & lattice,
+                   RefPart const & ref_part)
+    {
+        using T = tpsa::TPSA<T_Order>;
+
+        // identity map
+        T x = T::variable(0);
+        T px = T::variable(1);
+        T y = T::variable(2);
+        T py = T::variable(3);
+        T t = T::variable(4);
+        T pt = T::variable(5);
+
+        RefPart refpart = ref_part;
+        for (auto const & element_variant : lattice)
+        {
+            std::visit([&](auto element){
+                RefPart const entry = refpart;
+                for (int slice_step = 0; slice_step < element.nslice(); ++slice_step)
+                {
+                    prepare_slice(element, refpart, entry);
+                    element(x, y, t, px, py, pt, refpart);
+                    element(refpart);
+                }
+            }, element_variant);
+        }
+
+        // collect the nonzero coefficients, by component
+        tpsa::detail::MonomialTables const & tables = T::tables();
+        T const * const components[tpsa::nvar] = {&x, &px, &y, &py, &t, &pt};
+        std::vector<TaylorTerm> terms;
+        for (int c = 0; c < tpsa::nvar; ++c)
+        {
+            for (int k = 0; k < T::size; ++k)
+            {
+                amrex::Real const coef = (*components[c])[k];
+                if (coef == 0) { continue; }
+
+                TaylorTerm term;
+                term.component = c;
+                for (int v = 0; v < tpsa::nvar; ++v) { term.exponent[v] = tables.exponents[k][v]; }
+                term.coef = coef;
+                terms.push_back(term);
+            }
+        }
+        return terms;
+    }
+} // namespace
+
+    TaylorMap::TaylorMap (std::list<KnownElements> const & lattice,
+                          RefPart const & ref_part,
+                          int order)
+        : m_order(order)
+    {
+        BL_PROFILE("impactx::TaylorMap");
+
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(order >= 1 && order <= max_order,
+            "TaylorMap: order must be between 1 and " + std::to_string(max_order) + "!");
+
+        switch (order)
+        {
+            case 1: m_terms = extract_terms<1>(lattice, ref_part); break;
+            case 2: m_terms = extract_terms<2>(lattice, ref_part); break;
+            case 3: m_terms = extract_terms<3>(lattice, ref_part); break;
+            case 4: m_terms = extract_terms<4>(lattice, ref_part); break;
+            case 5: m_terms = extract_terms<5>(lattice, ref_part); break;
+            default: m_terms = extract_terms<6>(lattice, ref_part); break;
+        }
+
+        // copy the terms to the device
+        m_terms_d.resize(m_terms.size());
+        amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice,
+                              m_terms.begin(), m_terms.end(), m_terms_d.begin());
+        amrex::Gpu::streamSynchronize();
+    }
+
+    int
+    TaylorMap::order () const
+    {
+        return m_order;
+    }
+
+    int
+    TaylorMap::num_terms () const
+    {
+        return m_terms.size();
+    }
+
+    std::vector<TaylorTerm> const &
+    TaylorMap::terms () const
+    {
+        return m_terms;
+    }
+
+    TaylorTerm const *
+    TaylorMap::terms_data () const
+    {
+        return m_terms_d.data();
+    }
+
+} // namespace impactx
@@ -18,6 +18,8 @@
 #include <AMReX_REAL.H>       // for ParticleReal
 #include <AMReX_Print.H>      // for PrintToFile
 
+#include <sstream>
+
 
 namespace impactx::diagnostics
 {
@@ -31,17 +33,78 @@ namespace impactx::diagnostics
 
         using namespace amrex::literals; // for _rt and _prt
 
+        // the reference particle is the same on all MPI ranks and independent
+        // of the particle boxes: print it once from the I/O rank, in full
+        // double precision
+        if (otype == OutputType::PrintRefParticle) {
+            std::ostringstream ss;
+            ss.precision(17);
+            if (!append) {
+                ss << "step s x y z t px py pz pt\n";
+            }
+
+            // preparing to access reference particle data: RefPart
+            RefPart const ref_part = pc.GetRefParticle();
+
+            amrex::Real const s = ref_part.s;
+            amrex::Real const x = ref_part.x;
+            amrex::Real const y = ref_part.y;
+            amrex::Real const z = ref_part.z;
+            amrex::Real const t = ref_part.t;
+            amrex::Real const px = ref_part.px;
+            amrex::Real const py = ref_part.py;
+            amrex::Real const pz = ref_part.pz;
+            amrex::Real const pt = ref_part.pt;
+
+            // write particle data to file
+            ss << step << " " << s << " "
+               << x << " " << y << " " << z << " " << t << " "
+               << px << " " << py << " " << pz << " " << pt << "\n";
+            amrex::PrintToFile(file_name) << ss.str();
+            return;
+        }
+
+        // the loss record is kept on the host per MPI rank
+        if (otype == OutputType::PrintLostParticles) {
+            if (!append) {
+                amrex::AllPrintToFile(file_name) << "id x y t px py pt s\n";
+            }
+
+            LossRecord const & loss_record = pc.GetLossRecord();
+            for (std::size_t i = 0; i < loss_record.size(); ++i) {
+                amrex::AllPrintToFile(file_name)
+                        << loss_record.id[i] << " "
+                        << loss_record.x[i] << " " << loss_record.y[i] << " " << loss_record.t[i] << " "
+                        << loss_record.px[i] << " " << loss_record.py[i] << " " << loss_record.pt[i] << " "
+                        << loss_record.s[i] << "\n";
+            }
+            return;
+        }
+
         // write file header per MPI RANK
         if (!append) {
             if (otype == OutputType::PrintParticles) {
                 amrex::AllPrintToFile(file_name) << "id x y t px py pt\n";
             } else if (otype == OutputType::PrintNonlinearLensInvariants) {
                 amrex::AllPrintToFile(file_name) << "id H I\n";
-            } else if (otype == OutputType::PrintRefParticle) {
-                amrex::AllPrintToFile(file_name) << "step s x y z t px py pz pt\n";
             }
         }
 
+        // parameters of the invariants of the nonlinear lens, parsed once
+        // outside of the threaded tile loop
+        amrex::ParticleReal alpha = 0.0;
+        amrex::ParticleReal beta = 1.0;
+        amrex::ParticleReal tn = 0.4;
+        amrex::ParticleReal cn = 0.01;
+        if (otype == OutputType::PrintNonlinearLensInvariants) {
+            amrex::ParmParse pp_diag("diag");
+            pp_diag.queryAdd("alpha", alpha);
+            pp_diag.queryAdd("beta", beta);
+            pp_diag.queryAdd("tn", tn);
+            pp_diag.queryAdd("cn", cn);
+        }
+        NonlinearLensInvariants const nonlinear_lens_invariants(alpha, beta, tn, cn);
+
         // create a host-side particle buffer
         auto tmp = pc.make_alike<amrex::PinnedArenaAllocator>();
 
@@ -52,8 +115,12 @@ namespace impactx::diagnostics
         // loop over refinement levels
         int const nLevel = tmp.finestLevel();
         for (int lev = 0; lev <= nLevel; ++lev) {
-            // loop over all particle boxes
+            // loop over all particle tiles: each thread formats its tiles,
+            // then appends them to the file of its MPI rank one at a time
             using ParIt = typename decltype(tmp)::ParConstIterType;
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
             for (ParIt pti(tmp, lev); pti.isValid(); ++pti) {
                 const int np = pti.numParticles();
 
@@ -68,6 +135,8 @@ namespace impactx::diagnostics
                 amrex::ParticleReal const *const AMREX_RESTRICT part_py = soa_real[RealSoA::uy].dataPtr();
                 amrex::ParticleReal const *const AMREX_RESTRICT part_pt = soa_real[RealSoA::pt].dataPtr();
 
+                std::ostringstream ss;
+
                 if (otype == OutputType::PrintParticles) {
                     // print out particles (this hack works only on CPU and on GPUs with
                     // unified memory access)
@@ -86,33 +155,15 @@ namespace impactx::diagnostics
                         amrex::ParticleReal const pt = part_pt[i];
 
                         // write particle data to file
-                        amrex::AllPrintToFile(file_name)
-                                << global_id << " "
-                                << x << " " << y << " " << t << " "
-                                << px << " " << py << " " << pt << "\n";
+                        ss << global_id << " "
+                           << x << " " << y << " " << t << " "
+                           << px << " " << py << " " << pt << "\n";
                     } // i=0...np
                 } // if( otype == OutputType::PrintParticles)
                 else if (otype == OutputType::PrintNonlinearLensInvariants) {
 
                     using namespace amrex::literals;
 
-                    // Parse the diagnostic parameters
-                    amrex::ParmParse pp_diag("diag");
-
-                    amrex::ParticleReal alpha = 0.0;
-                    pp_diag.queryAdd("alpha", alpha);
-
-                    amrex::ParticleReal beta = 1.0;
-                    pp_diag.queryAdd("beta", beta);
-
-                    amrex::ParticleReal tn = 0.4;
-                    pp_diag.queryAdd("tn", tn);
-
-                    amrex::ParticleReal cn = 0.01;
-                    pp_diag.queryAdd("cn", cn);
-
-                    NonlinearLensInvariants const nonlinear_lens_invariants(alpha, beta, tn, cn);
-
                     // print out particles (this hack works only on CPU and on GPUs with
                     // unified memory access)
                     for (int i = 0; i < np; ++i) {
@@ -132,35 +183,17 @@ namespace impactx::diagnostics
                             nonlinear_lens_invariants(x, y, px, py);
 
                         // write particle invariant data to file
-                        amrex::AllPrintToFile(file_name)
-                                << global_id << " "
-                                << HI_out.H << " " << HI_out.I << "\n";
+                        ss << global_id << " "
+                           << HI_out.H << " " << HI_out.I << "\n";
 
                     } // i=0...np
                 } // if( otype == OutputType::PrintInvariants)
-                if (otype == OutputType::PrintRefParticle) {
-                    // print reference particle to file
-
-                    // preparing to access reference particle data: RefPart
-                    RefPart const ref_part = pc.GetRefParticle();
-
-                    amrex::ParticleReal const s = ref_part.s;
-                    amrex::ParticleReal const x = ref_part.x;
-                    amrex::ParticleReal const y = ref_part.y;
-                    amrex::ParticleReal const z = ref_part.z;
-                    amrex::ParticleReal const t = ref_part.t;
-                    amrex::ParticleReal const px = ref_part.px;
-                    amrex::ParticleReal const py = ref_part.py;
-                    amrex::ParticleReal const pz = ref_part.pz;
-                    amrex::ParticleReal const pt = ref_part.pt;
-
-                    // write particle data to file
-                    amrex::AllPrintToFile(file_name)
-                            << step << " " << s << " "
-                            << x << " " << y << " " << z << " " << t << " "
-                            << px << " " << py << " " << pz << " " << pt << "\n";
-                } // if( otype == OutputType::PrintRefParticle)
-            } // end loop over all particle boxes
+
+#ifdef AMREX_USE_OMP
+#pragma omp critical (impactx_diagnostic_output)
+#endif
+                amrex::AllPrintToFile(file_name) << ss.str();
+            } // end loop over all particle tiles
         } // env mesh-refinement level loop
     }
 
@@ -0,0 +1,173 @@
+/* Copyright 2022 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Chad Mitchell, Axel Huebl
+ * License: BSD-3-Clause-LBNL
+ */
+#include "RFCavityFieldMap.H"
+
+#include <AMReX.H>
+#include <AMReX_BLassert.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_Math.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_Vector.H>
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <map>
+#include <sstream>
+#include <utility>
+
+
+namespace impactx
+{
+namespace
+{
+    //! all field maps that were loaded so far, which are never removed
+    std::deque<RFCavityFieldMap> & field_maps ()
+    {
+        static std::deque<RFCavityFieldMap> maps;
+        return maps;
+    }
+
+    //! handles of the loaded field maps by file name and number of coefficients
+    std::map<std::pair<std::string, int>, int> & field_map_handles ()
+    {
+        static std::map<std::pair<std::string, int>, int> handles;
+        return handles;
+    }
+
+    /** Read a field map file on the I/O rank and broadcast it
+     *
+     * @param file_name name of the field map file
+     * @param[out] z positions in m
+     * @param[out] ez on-axis field in arbitrary units
+     */
+    void read_field_map_file (std::string const & file_name,
+                              std::vector<amrex::Real> & z,
+                              std::vector<amrex::Real> & ez)
+    {
+        amrex::Vector<char> file_chars;
+        amrex::ParallelDescriptor::ReadAndBcastFile(file_name, file_chars);
+        std::istringstream is(std::string(file_chars.data()));
+
+        std::string line;
+        while (std::getline(is, line))
+        {
+            auto const first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') { continue; }
+
+            std::istringstream ls(line);
+            amrex::Real zi, ezi;
+            if (!(ls >> zi >> ezi)) {
+                amrex::Abort("RFCavity: cannot parse line in field map " + file_name + ": " + line);
+            }
+            z.push_back(zi);
+            ez.push_back(ezi);
+        }
+    }
+} // namespace
+
+    amrex::Real
+    RFCavityFieldMap::field (amrex::Real const z) const
+    {
+        using namespace amrex::literals; // for _rt and _prt
+
+        constexpr amrex::Real pi = amrex::Math::pi<amrex::Real>();
+        amrex::Real const theta = 2.0_rt * pi * z / length;
+
+        amrex::Real f = 0.5_rt * cos_coef[0];
+        for (int n = 1; n < int(cos_coef.size()); ++n) {
+            f += cos_coef[n] * std::cos(n * theta) + sin_coef[n] * std::sin(n * theta);
+        }
+        return f;
+    }
+
+    amrex::Real
+    RFCavityFieldMap::field_derivative (amrex::Real const z) const
+    {
+        using namespace amrex::literals; // for _rt and _prt
+
+        constexpr amrex::Real pi = amrex::Math::pi<amrex::Real>();
+        amrex::Real const kl = 2.0_rt * pi / length;
+        amrex::Real const theta = kl * z;
+
+        amrex::Real fp = 0.0_rt;
+        for (int n = 1; n < int(cos_coef.size()); ++n) {
+            fp += n * kl * (sin_coef[n] * std::cos(n * theta) - cos_coef[n] * std::sin(n * theta));
+        }
+        return fp;
+    }
+
+    int
+    load_rf_cavity_field_map (std::string const & file_name, int const ncoef)
+    {
+        BL_PROFILE("impactx::load_rf_cavity_field_map");
+
+        using namespace amrex::literals; // for _rt and _prt
+
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(ncoef > 0,
+                                         "RFCavity: the number of Fourier coefficients must be positive!");
+
+        // reuse a field map that was loaded before
+        auto const key = std::make_pair(file_name, ncoef);
+        auto const known = field_map_handles().find(key);
+        if (known != field_map_handles().end()) { return known->second; }
+
+        std::vector<amrex::Real> z, ez;
+        read_field_map_file(file_name, z, ez);
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(z.size() >= 2,
+                                         "RFCavity: field map " + file_name + " needs at least two points!");
+        for (std::size_t i = 1; i < z.size(); ++i) {
+            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(z[i] > z[i-1],
+                                             "RFCavity: positions in field map " + file_name + " must increase!");
+        }
+
+        // normalize the field to a maximum magnitude of one
+        amrex::Real ez_max = 0.0_rt;
+        for (amrex::Real const e : ez) { ez_max = std::max(ez_max, std::abs(e)); }
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(ez_max > 0.0_rt,
+                                         "RFCavity: field map " + file_name + " is zero!");
+
+        // Fourier coefficients with the trapezoidal rule on the tabulated points
+        RFCavityFieldMap map;
+        map.length = z.back() - z.front();
+        map.cos_coef.assign(ncoef, 0.0_rt);
+        map.sin_coef.assign(ncoef, 0.0_rt);
+
+        constexpr amrex::Real pi = amrex::Math::pi<amrex::Real>();
+        amrex::Real const kl = 2.0_rt * pi / map.length;
+        for (std::size_t i = 0; i + 1 < z.size(); ++i)
+        {
+            amrex::Real const dz = z[i+1] - z[i];
+            for (std::size_t j = i; j <= i + 1; ++j)
+            {
+                amrex::Real const w = 0.5_rt * dz * ez[j] / ez_max * 2.0_rt / map.length;
+                amrex::Real const theta = kl * (z[j] - z.front());
+                for (int n = 0; n < ncoef; ++n) {
+                    map.cos_coef[n] += w * std::cos(n * theta);
+                    map.sin_coef[n] += w * std::sin(n * theta);
+                }
+            }
+        }
+
+        int const handle = static_cast<int>(field_maps().size());
+        field_maps().push_back(std::move(map));
+        field_map_handles()[key] = handle;
+        return handle;
+    }
+
+    RFCavityFieldMap const &
+    get_rf_cavity_field_map (int const handle)
+    {
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(handle >= 0 && handle < int(field_maps().size()),
+                                         "RFCavity: unknown field map!");
+        return field_maps()[handle];
+    }
+
+} // namespace impactx
@@ -0,0 +1,228 @@
+/* Copyright 2022 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Chad Mitchell, Axel Huebl
+ * License: BSD-3-Clause-LBNL
+ */
+#include "Envelope.H"
+#include "particles/tpsa/TPSA.H"
+
+#include <AMReX_BLassert.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_Reduce.H>
+
+#include <algorithm>
+#include <cmath>
+#include <variant>
+
+
+namespace impactx::envelope
+{
+    CovarianceMatrix
+    create_covariance (amrex::Real const sigx, amrex::Real const sigy, amrex::Real const sigt,
+                       amrex::Real const sigpx, amrex::Real const sigpy, amrex::Real const sigpt,
+                       amrex::Real const muxpx, amrex::Real const muypy, amrex::Real const mutpt)
+    {
+        using namespace amrex::literals; // for _rt and _prt
+
+        CovarianceMatrix cm{};
+        for (int i = 1; i <= 6; ++i) {
+            for (int j = 1; j <= 6; ++j) {
+                cm(i, j) = 0.0_rt;
+            }
+        }
+
+        // the distributions scale uncorrelated samples of unit variance (u, v) to
+        // x = sig*u/root and px = sigp*(-mu*u/root + v), with root = sqrt(1-mu^2)
+        amrex::Real const sig[3] = {sigx, sigy, sigt};
+        amrex::Real const sigp[3] = {sigpx, sigpy, sigpt};
+        amrex::Real const mu[3] = {muxpx, muypy, mutpt};
+        for (int d = 0; d < 3; ++d)
+        {
+            amrex::Real const root2 = 1.0_rt - mu[d]*mu[d];
+            int const i = 2*d + 1;
+            cm(i, i) = sig[d]*sig[d] / root2;
+            cm(i, i+1) = -mu[d]*sig[d]*sigp[d] / root2;
+            cm(i+1, i) = cm(i, i+1);
+            cm(i+1, i+1) = sigp[d]*sigp[d] / root2;
+        }
+        return cm;
+    }
+
+    CovarianceMatrix
+    beam_covariance (ImpactXParticleContainer const & pc)
+    {
+        BL_PROFILE("impactx::envelope::beam_covariance");
+
+        using namespace amrex::literals; // for _rt and _prt
+
+        // weighted sums of the coordinates and of their pairwise products,
+        // one row of products per reduction
+        amrex::Real sums[1 + 6 + 6*6] = {};
+        amrex::Real & sum_w = sums[0];
+        amrex::Real * const sum_z = sums + 1;
+        amrex::Real * const sum_zz = sums + 7;
+
+        for (int i = 0; i < 6; ++i)
+        {
+            amrex::ReduceOps<amrex::ReduceOpSum, amrex::ReduceOpSum, amrex::ReduceOpSum,
+                             amrex::ReduceOpSum, amrex::ReduceOpSum, amrex::ReduceOpSum,
+                             amrex::ReduceOpSum, amrex::ReduceOpSum> reduce_ops;
+            amrex::ReduceData<amrex::Real, amrex::Real, amrex::Real, amrex::Real,
+                              amrex::Real, amrex::Real, amrex::Real, amrex::Real> reduce_data(reduce_ops);
+            using ReduceTuple = typename decltype(reduce_data)::Type;
+
+            int const nLevel = pc.finestLevel();
+            for (int lev = 0; lev <= nLevel; ++lev)
+            {
+                using ParIt = ImpactXParticleContainer::const_iterator;
+                for (ParIt pti(pc, lev); pti.isValid(); ++pti)
+                {
+                    int const np = pti.numParticles();
+
+                    using PType = ImpactXParticleContainer::ParticleType;
+                    PType const * const AMREX_RESTRICT aos_ptr = pti.GetArrayOfStructs()().dataPtr();
+                    auto const & soa_real = pti.GetStructOfArrays().GetRealData();
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_px = soa_real[RealSoA::ux].dataPtr();
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_py = soa_real[RealSoA::uy].dataPtr();
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_pt = soa_real[RealSoA::pt].dataPtr();
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_w = soa_real[RealSoA::w].dataPtr();
+
+                    reduce_ops.eval(np, reduce_data,
+                        [=] AMREX_GPU_DEVICE (int ip) -> ReduceTuple
+                        {
+                            PType const & p = aos_ptr[ip];
+                            amrex::Real const z[6] = {p.pos(RealAoS::x), part_px[ip],
+                                                      p.pos(RealAoS::y), part_py[ip],
+                                                      p.pos(RealAoS::z), part_pt[ip]};
+                            amrex::Real const w = part_w[ip];
+                            amrex::Real const wz = w * z[i];
+                            return {w, wz, wz*z[0], wz*z[1], wz*z[2], wz*z[3], wz*z[4], wz*z[5]};
+                        });
+                }
+            }
+
+            ReduceTuple const r = reduce_data.value(reduce_ops);
+            sum_w = amrex::get<0>(r);
+            sum_z[i] = amrex::get<1>(r);
+            sum_zz[6*i + 0] = amrex::get<2>(r);
+            sum_zz[6*i + 1] = amrex::get<3>(r);
+            sum_zz[6*i + 2] = amrex::get<4>(r);
+            sum_zz[6*i + 3] = amrex::get<5>(r);
+            sum_zz[6*i + 4] = amrex::get<6>(r);
+            sum_zz[6*i + 5] = amrex::get<7>(r);
+        }
+        amrex::ParallelDescriptor::ReduceRealSum(sums, 1 + 6 + 6*6);
+
+        CovarianceMatrix cm{};
+        for (int i = 1; i <= 6; ++i) {
+            for (int j = 1; j <= 6; ++j) {
+                cm(i, j) = 0.0_rt;
+            }
+        }
+        if (sum_w <= 0.0_rt) { return cm; }
+
+        for (int i = 0; i < 6; ++i) {
+            for (int j = 0; j < 6; ++j) {
+                cm(i+1, j+1) = sum_zz[6*i + j] / sum_w - sum_z[i] * sum_z[j] / (sum_w * sum_w);
+            }
+        }
+        return cm;
+    }
+
+    Map6x6
+    linear_map (KnownElements const & element_variant,
+                RefPart const & refpart)
+    {
+        using T = tpsa::TPSA<1>;
+
+        // push the identity map through the slice
+        T x = T::variable(0);
+        T px = T::variable(1);
+        T y = T::variable(2);
+        T py = T::variable(3);
+        T t = T::variable(4);
+        T pt = T::variable(5);
+        std::visit([&](auto && element){
+            element(x, y, t, px, py, pt, refpart);
+        }, element_variant);
+
+        // the coefficients of the first-order monomials are the matrix elements
+        T const * const components[tpsa::nvar] = {&x, &px, &y, &py, &t, &pt};
+        Map6x6 R{};
+        for (int i = 1; i <= 6; ++i) {
+            for (int j = 1; j <= 6; ++j) {
+                R(i, j) = (*components[i-1])[j];
+            }
+        }
+        return R;
+    }
+
+    CovarianceMatrix
+    transport (Map6x6 const & R, CovarianceMatrix const & cm)
+    {
+        Map6x6 Rt{};
+        for (int i = 1; i <= 6; ++i) {
+            for (int j = 1; j <= 6; ++j) {
+                Rt(i, j) = R(j, i);
+            }
+        }
+        return compose(R, compose(cm, Rt));
+    }
+
+    amrex::Real
+    perveance (amrex::Real const current, RefPart const & refpart)
+    {
+        using namespace amrex::literals; // for _rt and _prt
+
+        // characteristic current I0 = 4 pi eps0 m c^3 / |q| in A,
+        // with 1/(4 pi eps0 c) = 29.9792458 Ohm
+        amrex::Real const I0 = refpart.mass_MeV() * 1.0e6_rt /
+                               (29.9792458_rt * std::abs(refpart.charge_qe()));
+        amrex::Real const bg = refpart.beta_gamma();
+        return 2.0_rt * current / (I0 * bg*bg*bg);
+    }
+
+    void
+    space_charge_kick (CovarianceMatrix & cm,
+                       amrex::Real const perveance,
+                       amrex::Real const ds)
+    {
+        using namespace amrex::literals; // for _rt and _prt
+
+        // a KV beam with edge radii a = 2 sig_x and b = 2 sig_y has the linear
+        // force x'' = 2 K x / (a (a+b)) inside the beam
+        amrex::Real const sigx = std::sqrt(cm(1, 1));
+        amrex::Real const sigy = std::sqrt(cm(3, 3));
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(sigx > 0.0_rt && sigy > 0.0_rt,
+                                         "space_charge_kick: beam has zero transverse size!");
+
+        Map6x6 R = identity_map();
+        R(2, 1) = perveance * ds / (2.0_rt * sigx * (sigx + sigy));
+        R(4, 3) = perveance * ds / (2.0_rt * sigy * (sigx + sigy));
+        cm = transport(R, cm);
+    }
+
+    void
+    PrintLine (std::ostream & os,
+               int const step,
+               RefPart const & refpart,
+               CovarianceMatrix const & cm)
+    {
+        using namespace amrex::literals; // for _rt and _prt
+
+        os << step << " " << refpart.s;
+        for (int i = 1; i <= 6; i += 2) { os << " " << std::sqrt(cm(i, i)); }
+        for (int i = 2; i <= 6; i += 2) { os << " " << std::sqrt(cm(i, i)); }
+        for (int i = 1; i <= 6; i += 2) {
+            amrex::Real const det = cm(i, i)*cm(i+1, i+1) - cm(i, i+1)*cm(i+1, i);
+            os << " " << std::sqrt(std::max(det, 0.0_rt));
+        }
+        os << "\n";
+    }
+
+} // namespace impactx::envelope
@@ -0,0 +1,211 @@
+/* Copyright 2022 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl, Chad Mitchell, Ji Qiang
+ * License: BSD-3-Clause-LBNL
+ */
+#include "GatherAndPush.H"
+#include "ShapeFactor.H"
+#include "particles/transformation/ToFixedT.H"
+
+#include <AMReX.H>
+#include <AMReX_Array4.H>
+#include <AMReX_BLassert.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_Extension.H>
+#include <AMReX_GpuLaunch.H>
+#include <AMReX_GpuQualifiers.H>
+#include <AMReX_Math.H>
+
+#include <cmath>
+#include <type_traits>
+
+
+namespace impactx::spacecharge
+{
+namespace
+{
+    /** Gather the field and kick the particles of one box
+     *
+     * With to_fixed_t, the particles are in x, y, t coordinates at fixed s.
+     * The field is gathered at their position at fixed t, but the kick at
+     * fixed t is applied to the particles at fixed s. With the momenta in
+     * units of mc and E = ptd + pt = -gamma, a particle is at x + px t / E
+     * and z = pz t / E at fixed t, so a kick dpx, dpy, dpz at fixed t
+     * changes x, y, t and E to
+     *   x + (px - px' pz / pz') t / E, y + (py - py' pz / pz') t / E,
+     *   t pz E' / (pz' E) and E' = -sqrt(E^2 + dpx (2 px + dpx) + ...),
+     * with the kicked momenta px', py', pz'. This is ToFixedS after the
+     * kick, \see SpaceCharge2p5D.
+     *
+     * @tparam order order of the particle shape, 1, 2 or 3
+     * @tparam to_fixed_t transform the particles from fixed s to fixed t on the fly
+     * @param pti the particle box
+     * @param field electric field in the rest frame on the nodes of the box, with guard nodes
+     * @param plo position of the node of index zero
+     * @param dxi inverse cell size
+     * @param kick_xy momentum kick in x and y per rest frame field (1/(V/m))
+     * @param kick_z momentum kick in z per rest frame field (1/(V/m))
+     * @param ref_part the reference particle
+     */
+    template <int order, bool to_fixed_t>
+    void
+    gather_and_push (ImpactXParticleContainer::iterator & pti,
+                     amrex::Array4<amrex::Real const> const & field,
+                     amrex::GpuArray<amrex::Real, 3> const & plo,
+                     amrex::GpuArray<amrex::Real, 3> const & dxi,
+                     amrex::Real const kick_xy,
+                     amrex::Real const kick_z,
+                     RefPart const & ref_part)
+    {
+        using namespace amrex::literals; // for _rt and _prt
+
+        int const np = pti.numParticles();
+
+        // preparing access to particle data: AoS
+        using PType = ImpactXParticleContainer::ParticleType;
+        auto & aos = pti.GetArrayOfStructs();
+        PType * const AMREX_RESTRICT aos_ptr = aos().dataPtr();
+
+        // preparing access to particle data: SoA of Reals
+        auto & soa_real = pti.GetStructOfArrays().GetRealData();
+        amrex::ParticleReal * const AMREX_RESTRICT part_px = soa_real[RealSoA::ux].dataPtr();
+        amrex::ParticleReal * const AMREX_RESTRICT part_py = soa_real[RealSoA::uy].dataPtr();
+        amrex::ParticleReal * const AMREX_RESTRICT part_pz = soa_real[RealSoA::pt].dataPtr();
+
+        // reference values: pt = -gamma and pz = beta*gamma
+        amrex::Real const ptd = ref_part.pt;
+        amrex::Real const pzd = ref_part.beta_gamma();
+        transformation::ToFixedT const to_t(ptd);
+
+        amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (long i)
+        {
+            PType & p = aos_ptr[i];
+
+            // position at fixed t
+            amrex::Real x = p.pos(RealAoS::x);
+            amrex::Real y = p.pos(RealAoS::y);
+            amrex::Real z = p.pos(RealAoS::z);
+            amrex::Real px = part_px[i];
+            amrex::Real py = part_py[i];
+            amrex::Real pz = part_pz[i];
+            if constexpr (to_fixed_t) {
+                to_t(x, y, z, px, py, pz);
+            }
+
+            amrex::Real sx[order + 1], sy[order + 1], sz[order + 1];
+            int const i0 = shape_factor<order>(sx, (x - plo[0]) * dxi[0]);
+            int const j0 = shape_factor<order>(sy, (y - plo[1]) * dxi[1]);
+            int const k0 = shape_factor<order>(sz, (z - plo[2]) * dxi[2]);
+
+            amrex::Real ex = 0, ey = 0, ez = 0;
+            for (int kz = 0; kz <= order; ++kz) {
+                for (int jy = 0; jy <= order; ++jy) {
+                    for (int ix = 0; ix <= order; ++ix) {
+                        amrex::Real const w = sx[ix] * sy[jy] * sz[kz];
+                        ex += w * field(i0 + ix, j0 + jy, k0 + kz, 0);
+                        ey += w * field(i0 + ix, j0 + jy, k0 + kz, 1);
+                        ez += w * field(i0 + ix, j0 + jy, k0 + kz, 2);
+                    }
+                }
+            }
+
+            if constexpr (to_fixed_t) {
+                // kick at fixed t, applied at fixed s in units of mc
+                amrex::Real const dpx = pzd * kick_xy * ex;
+                amrex::Real const dpy = pzd * kick_xy * ey;
+                amrex::Real const dpz = pzd * kick_z * ez;
+                amrex::Real const px_s = pzd * part_px[i];
+                amrex::Real const py_s = pzd * part_py[i];
+                amrex::Real const pz_t = pzd * (1.0_rt + pz);
+                amrex::Real const pz_new = pz_t + dpz;
+                amrex::Real const energy = ptd + pzd * part_pz[i];
+                amrex::Real const energy_new = -std::sqrt(
+                    energy * energy + dpx * (2.0_rt * px_s + dpx) + dpy * (2.0_rt * py_s + dpy)
+                    + dpz * (2.0_rt * pz_t + dpz));
+                amrex::Real const t_over_energy = p.pos(RealAoS::z) / energy;
+
+                p.pos(RealAoS::x) += (px_s - (px_s + dpx) * pz_t / pz_new) * t_over_energy;
+                p.pos(RealAoS::y) += (py_s - (py_s + dpy) * pz_t / pz_new) * t_over_energy;
+                p.pos(RealAoS::z) = t_over_energy * pz_t * energy_new / pz_new;
+                part_px[i] += dpx / pzd;
+                part_py[i] += dpy / pzd;
+                part_pz[i] = (energy_new - ptd) / pzd;
+            } else {
+                part_px[i] += kick_xy * ex;
+                part_py[i] += kick_xy * ey;
+                part_pz[i] += kick_z * ez;
+            }
+        });
+    }
+} // namespace
+
+    void
+    GatherAndPush (ImpactXParticleContainer & pc,
+                   std::unordered_map<int, amrex::MultiFab> const & space_charge_field,
+                   amrex::Real const ds,
+                   bool const to_fixed_t)
+    {
+        BL_PROFILE("impactx::spacecharge::GatherAndPush");
+
+        using namespace amrex::literals; // for _rt and _prt
+
+        // the momenta at fixed t are normalized by the reference momentum
+        // m c beta gamma and the rest energy m c^2 is in eV, so the kick of
+        // a field in V/m over ds is q E ds / (m c^2 beta^2 gamma^2) in x and
+        // y and q E ds / (m c^2 beta^2 gamma) in z, with q in elementary
+        // charges
+        RefPart const ref_part = pc.GetRefParticle();
+        amrex::Real const bg = ref_part.beta_gamma();
+        amrex::Real const kick_xy = ref_part.charge_qe() * ds /
+                                    (ref_part.mass_MeV() * 1.0e6_rt * bg * bg);
+        amrex::Real const kick_z = kick_xy * ref_part.gamma();
+
+        int const shape = pc.GetParticleShape();
+
+        // loop over refinement levels
+        int const nLevel = pc.finestLevel();
+        for (int lev = 0; lev <= nLevel; ++lev)
+        {
+            amrex::MultiFab const & field_at_level = space_charge_field.at(lev);
+
+            // the node of index zero is at the lower corner of the domain
+            amrex::Geometry const & gm = pc.Geom(lev);
+            amrex::GpuArray<amrex::Real, 3> const plo = gm.ProbLoArray();
+            amrex::GpuArray<amrex::Real, 3> const dxi = gm.InvCellSizeArray();
+
+            // loop over all particle boxes
+            using ParIt = ImpactXParticleContainer::iterator;
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+            for (ParIt pti(pc, lev); pti.isValid(); ++pti)
+            {
+                amrex::Array4<amrex::Real const> const field = field_at_level.const_array(pti);
+
+                auto const push = [&](auto order) {
+                    constexpr int o = decltype(order)::value;
+                    if (to_fixed_t) {
+                        gather_and_push<o, true>(pti, field, plo, dxi, kick_xy, kick_z, ref_part);
+                    } else {
+                        gather_and_push<o, false>(pti, field, plo, dxi, kick_xy, kick_z, ref_part);
+                    }
+                };
+
+                if (shape == 1) {
+                    push(std::integral_constant<int, 1>{});
+                } else if (shape == 2) {
+                    push(std::integral_constant<int, 2>{});
+                } else if (shape == 3) {
+                    push(std::integral_constant<int, 3>{});
+                } else {
+                    amrex::Abort("GatherAndPush: algo.particle_shape must be 1, 2 or 3!");
+                }
+            }
+        }
+    }
+
+} // namespace impactx::spacecharge
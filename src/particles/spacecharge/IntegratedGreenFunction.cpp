@@ -0,0 +1,319 @@
+/* Copyright 2022 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl, Chad Mitchell, Ji Qiang
+ * License: BSD-3-Clause-LBNL
+ */
+#include "IntegratedGreenFunction.H"
+
+#include <AMReX.H>
+#include <AMReX_BLassert.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_ParallelDescriptor.H>
+
+#ifdef AMREX_USE_MPI
+#   include <fftw3-mpi.h>
+#else
+#   include <fftw3.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <functional>
+#include <vector>
+
+
+namespace impactx::spacecharge
+{
+namespace
+{
+#ifdef AMREX_USE_FLOAT
+    using Plan = fftwf_plan;
+    using FFTWComplex = fftwf_complex;
+    constexpr auto execute = &fftwf_execute;
+    constexpr auto destroy_plan = &fftwf_destroy_plan;
+#   ifdef AMREX_USE_MPI
+    constexpr auto mpi_init = &fftwf_mpi_init;
+    constexpr auto mpi_local_size = &fftwf_mpi_local_size_3d_transposed;
+    constexpr auto mpi_plan_r2c = &fftwf_mpi_plan_dft_r2c_3d;
+    constexpr auto mpi_plan_c2r = &fftwf_mpi_plan_dft_c2r_3d;
+#   else
+    constexpr auto plan_r2c = &fftwf_plan_dft_r2c_3d;
+    constexpr auto plan_c2r = &fftwf_plan_dft_c2r_3d;
+#   endif
+#else
+    using Plan = fftw_plan;
+    using FFTWComplex = fftw_complex;
+    constexpr auto execute = &fftw_execute;
+    constexpr auto destroy_plan = &fftw_destroy_plan;
+#   ifdef AMREX_USE_MPI
+    constexpr auto mpi_init = &fftw_mpi_init;
+    constexpr auto mpi_local_size = &fftw_mpi_local_size_3d_transposed;
+    constexpr auto mpi_plan_r2c = &fftw_mpi_plan_dft_r2c_3d;
+    constexpr auto mpi_plan_c2r = &fftw_mpi_plan_dft_c2r_3d;
+#   else
+    constexpr auto plan_r2c = &fftw_plan_dft_r2c_3d;
+    constexpr auto plan_c2r = &fftw_plan_dft_c2r_3d;
+#   endif
+#endif
+
+    /** Antiderivative of 1/r with respect to x, y and z
+     *
+     * @param x position in x, nonzero
+     * @param y position in y, nonzero
+     * @param z position in z, nonzero
+     * @returns F(x,y,z) with d^3 F / (dx dy dz) = 1/r
+     */
+    double
+    antiderivative (double const x, double const y, double const z)
+    {
+        double const r = std::sqrt(x*x + y*y + z*z);
+        return y*z*std::log(x + r) + x*z*std::log(y + r) + x*y*std::log(z + r)
+               - 0.5 * x*x * std::atan(y*z / (x*r))
+               - 0.5 * y*y * std::atan(x*z / (y*r))
+               - 0.5 * z*z * std::atan(x*y / (z*r));
+    }
+
+    /** Integral of 1/r over a cell
+     *
+     * The integral only depends on the distance of the cell center from
+     * the origin in each direction. It is evaluated at nonnegative distances,
+     * where none of the logarithms of the antiderivative cancels.
+     *
+     * @param x distance of the cell center in x (m)
+     * @param y distance of the cell center in y (m)
+     * @param z distance of the cell center in z (m)
+     * @param dx cell size in x, y, z (m)
+     * @returns integral of 1/r over the cell (m^2)
+     */
+    double
+    integrated_green_function (double x, double y, double z,
+                               std::array<double, 3> const & dx)
+    {
+        x = std::abs(x);
+        y = std::abs(y);
+        z = std::abs(z);
+        double const hx = 0.5 * dx[0];
+        double const hy = 0.5 * dx[1];
+        double const hz = 0.5 * dx[2];
+
+        double g = 0.0;
+        for (int a = -1; a <= 1; a += 2) {
+            for (int b = -1; b <= 1; b += 2) {
+                for (int c = -1; c <= 1; c += 2) {
+                    g += a * b * c * antiderivative(x + a*hx, y + b*hy, z + c*hz);
+                }
+            }
+        }
+        return g;
+    }
+} // namespace
+
+    struct IntegratedGreenFunction::FFT
+    {
+        /** Allocate the buffers of this MPI rank and create the plans
+         *
+         * The padded grid is stored row-major with z running slowest and the
+         * x dimension padded to 2*(nx/2+1) reals, as needed by in-place
+         * real-to-complex FFTs. With MPI, it is distributed in slabs of
+         * planes in z, and the Fourier transform is stored transposed in y
+         * and z, which saves a global transpose in each direction: the
+         * Green's function is transformed with the same plan, so products
+         * of both are taken on the same local layout.
+         *
+         * @param n number of nodes in x, y, z
+         */
+        FFT (std::array<int, 3> const & n)
+        {
+            // twice the number of nodes, for the zero padding
+            nx = 2 * n[0];
+            ny = 2 * n[1];
+            nz = 2 * n[2];
+            nxc = nx / 2 + 1;
+
+            // FFTW is row-major, so the x index, which runs fastest, comes last
+#ifdef AMREX_USE_MPI
+            static bool const mpi_initialized = (mpi_init(), true);
+            amrex::ignore_unused(mpi_initialized);
+
+            MPI_Comm const comm = amrex::ParallelDescriptor::Communicator();
+            ptrdiff_t local_nz, local_z_start, local_ny, local_y_start;
+            ptrdiff_t const alloc = mpi_local_size(nz, ny, nxc, comm,
+                                                   &local_nz, &local_z_start,
+                                                   &local_ny, &local_y_start);
+            z_begin = static_cast<int>(local_z_start);
+            z_count = static_cast<int>(local_nz);
+            num_complex = std::size_t(local_ny) * nz * nxc;
+            real.resize(2 * std::max<std::size_t>(alloc, 1));
+
+            auto * const c = reinterpret_cast<FFTWComplex *>(real.data());
+            forward = mpi_plan_r2c(nz, ny, nx, real.data(), c, comm,
+                                   FFTW_ESTIMATE | FFTW_MPI_TRANSPOSED_OUT);
+            backward = mpi_plan_c2r(nz, ny, nx, c, real.data(), comm,
+                                    FFTW_ESTIMATE | FFTW_MPI_TRANSPOSED_IN);
+#else
+            z_begin = 0;
+            z_count = nz;
+            num_complex = std::size_t(nz) * ny * nxc;
+            real.resize(2 * num_complex);
+
+            auto * const c = reinterpret_cast<FFTWComplex *>(real.data());
+            forward = plan_r2c(nz, ny, nx, real.data(), c, FFTW_ESTIMATE);
+            backward = plan_c2r(nz, ny, nx, c, real.data(), FFTW_ESTIMATE);
+#endif
+            green.resize(num_complex);
+        }
+
+        ~FFT ()
+        {
+            destroy_plan(forward);
+            destroy_plan(backward);
+        }
+
+        FFT (FFT const &) = delete;
+        FFT & operator= (FFT const &) = delete;
+
+        /** Index of a point of the local slab in the padded real data
+         *
+         * @param i index in x
+         * @param j index in y
+         * @param k index in z, relative to z_begin
+         */
+        std::size_t
+        index (int const i, int const j, int const k) const
+        {
+            return i + 2 * std::size_t(nxc) * (j + std::size_t(ny) * k);
+        }
+
+        /** The Fourier transform of the local slab, in place of the real data */
+        std::complex<amrex::Real> *
+        complex ()
+        {
+            return reinterpret_cast<std::complex<amrex::Real> *>(real.data());
+        }
+
+        int nx, ny, nz; //! size of the padded grid
+        int nxc; //! number of complex values in x
+        int z_begin; //! first plane in z of the padded grid on this MPI rank
+        int z_count; //! number of planes in z of the padded grid on this MPI rank
+        std::size_t num_complex; //! number of complex values of the Fourier transform on this MPI rank
+        std::vector<amrex::Real> real; //! padded real data of the local slab, rho and phi, and its Fourier transform
+        std::vector<std::complex<amrex::Real>> green; //! scaled Fourier transform of the Green's function
+        Plan forward; //! real to complex in place
+        Plan backward; //! complex to real in place
+    };
+
+    IntegratedGreenFunction::IntegratedGreenFunction () = default;
+
+    IntegratedGreenFunction::~IntegratedGreenFunction () = default;
+
+    void
+    IntegratedGreenFunction::update_green_function ()
+    {
+        BL_PROFILE("impactx::spacecharge::IntegratedGreenFunction::update_green_function");
+
+        // 1 / (4 pi epsilon0) in V m / C
+        constexpr double coulomb = 8.9875517923e9;
+
+        FFT & fft = *m_fft;
+        std::array<double, 3> const dx = {double(m_dx[0]), double(m_dx[1]), double(m_dx[2])};
+
+        // Green's function at the cyclic offsets of the padded grid: the
+        // upper half of each direction holds the negative offsets. It is
+        // computed in double precision, since the integral over a distant
+        // cell is a small difference of large antiderivatives.
+        std::fill(fft.real.begin(), fft.real.end(), amrex::Real(0));
+        for (int kl = 0; kl < fft.z_count; ++kl) {
+            int const k = fft.z_begin + kl;
+            double const z = (k < m_n[2] ? k : k - fft.nz) * dx[2];
+            for (int j = 0; j < fft.ny; ++j) {
+                double const y = (j < m_n[1] ? j : j - fft.ny) * dx[1];
+                for (int i = 0; i < fft.nx; ++i) {
+                    double const x = (i < m_n[0] ? i : i - fft.nx) * dx[0];
+                    fft.real[fft.index(i, j, kl)] =
+                        amrex::Real(integrated_green_function(x, y, z, dx));
+                }
+            }
+        }
+        execute(fft.forward);
+
+        // include 1 / (4 pi epsilon0) and the normalization of the inverse FFT
+        amrex::Real const scale = amrex::Real(coulomb / (double(fft.nx) * fft.ny * fft.nz));
+        std::transform(fft.complex(), fft.complex() + fft.num_complex, fft.green.begin(),
+                       [scale](std::complex<amrex::Real> const & c){ return scale * c; });
+
+        ++m_num_green_functions;
+    }
+
+    std::array<int, 2>
+    IntegratedGreenFunction::local_slab (std::array<int, 3> const & n)
+    {
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(n[0] > 0 && n[1] > 0 && n[2] > 0,
+            "IntegratedGreenFunction: the grid has no nodes!");
+
+        // the plans depend on the number of nodes, the Green's function also on the cell size
+        if (!m_fft || n != m_n)
+        {
+            m_fft.reset();
+            m_fft = std::make_unique<FFT>(n);
+            m_n = n;
+            m_dx = {0, 0, 0};
+        }
+
+        // the upper half of the padded planes holds no nodes
+        int const begin = std::min(m_fft->z_begin, n[2]);
+        int const end = std::min(m_fft->z_begin + m_fft->z_count, n[2]);
+        return {begin, end - begin};
+    }
+
+    void
+    IntegratedGreenFunction::solve (std::array<int, 3> const & n,
+                                    std::array<amrex::Real, 3> const & dx,
+                                    amrex::Real const * rho,
+                                    amrex::Real * phi)
+    {
+        BL_PROFILE("impactx::spacecharge::IntegratedGreenFunction::solve");
+
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(dx[0] > 0 && dx[1] > 0 && dx[2] > 0,
+            "IntegratedGreenFunction: the cell size must be positive!");
+
+        std::array<int, 2> const slab = local_slab(n);
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(slab[1] == 0 || (rho != nullptr && phi != nullptr),
+            "IntegratedGreenFunction: no charge density or potential for the local slab!");
+        if (dx != m_dx)
+        {
+            m_dx = dx;
+            update_green_function();
+        }
+
+        FFT & fft = *m_fft;
+        std::size_t const sx = n[0];
+        std::size_t const sxy = sx * n[1];
+
+        // zero-padded charge density of the local slab
+        std::fill(fft.real.begin(), fft.real.end(), amrex::Real(0));
+        for (int kl = 0; kl < slab[1]; ++kl) {
+            for (int j = 0; j < n[1]; ++j) {
+                std::copy_n(rho + j*sx + kl*sxy, n[0], fft.real.begin() + fft.index(0, j, kl));
+            }
+        }
+
+        // convolution with the Green's function
+        execute(fft.forward);
+        std::transform(fft.complex(), fft.complex() + fft.num_complex, fft.green.begin(),
+                       fft.complex(), std::multiplies<>());
+        execute(fft.backward);
+
+        // the potential on the nodes of the local slab of the unpadded grid
+        for (int kl = 0; kl < slab[1]; ++kl) {
+            for (int j = 0; j < n[1]; ++j) {
+                std::copy_n(fft.real.begin() + fft.index(0, j, kl), n[0], phi + j*sx + kl*sxy);
+            }
+        }
+    }
+
+} // namespace impactx::spacecharge
@@ -0,0 +1,206 @@
+/* Copyright 2022 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl, Chad Mitchell, Ji Qiang
+ * License: BSD-3-Clause-LBNL
+ */
+#include "IntegratedGreenFunction2D.H"
+
+#include <AMReX_BLassert.H>
+#include <AMReX_BLProfiler.H>
+
+#include <fftw3.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <functional>
+#include <vector>
+
+
+namespace impactx::spacecharge
+{
+namespace
+{
+#ifdef AMREX_USE_FLOAT
+    using Plan = fftwf_plan;
+    using FFTWComplex = fftwf_complex;
+    constexpr auto plan_r2c = &fftwf_plan_dft_r2c_2d;
+    constexpr auto plan_c2r = &fftwf_plan_dft_c2r_2d;
+    constexpr auto execute = &fftwf_execute;
+    constexpr auto destroy_plan = &fftwf_destroy_plan;
+#else
+    using Plan = fftw_plan;
+    using FFTWComplex = fftw_complex;
+    constexpr auto plan_r2c = &fftw_plan_dft_r2c_2d;
+    constexpr auto plan_c2r = &fftw_plan_dft_c2r_2d;
+    constexpr auto execute = &fftw_execute;
+    constexpr auto destroy_plan = &fftw_destroy_plan;
+#endif
+
+    /** Antiderivative of ln(r) with respect to x and y
+     *
+     * @param x position in x, nonzero
+     * @param y position in y, nonzero
+     * @returns F(x,y) with d^2 F / (dx dy) = ln(r)
+     */
+    double
+    antiderivative (double const x, double const y)
+    {
+        return 0.5 * x*y * std::log(x*x + y*y) - 1.5 * x*y
+               + 0.5 * x*x * std::atan(y / x)
+               + 0.5 * y*y * std::atan(x / y);
+    }
+
+    /** Integral of -ln(r) over a cell
+     *
+     * @param x distance of the cell center in x (m)
+     * @param y distance of the cell center in y (m)
+     * @param dx cell size in x, y (m)
+     * @returns integral of -ln(r/m) over the cell (m^2)
+     */
+    double
+    integrated_green_function (double x, double y,
+                               std::array<double, 2> const & dx)
+    {
+        x = std::abs(x);
+        y = std::abs(y);
+        double const hx = 0.5 * dx[0];
+        double const hy = 0.5 * dx[1];
+
+        double g = 0.0;
+        for (int a = -1; a <= 1; a += 2) {
+            for (int b = -1; b <= 1; b += 2) {
+                g -= a * b * antiderivative(x + a*hx, y + b*hy);
+            }
+        }
+        return g;
+    }
+} // namespace
+
+    struct IntegratedGreenFunction2D::FFT
+    {
+        /** Allocate the buffers and create the plans
+         *
+         * @param n number of nodes in x, y
+         */
+        FFT (std::array<int, 2> const & n)
+        {
+            // twice the number of nodes, for the zero padding
+            int const nx = 2 * n[0];
+            int const ny = 2 * n[1];
+            real.resize(std::size_t(nx) * ny);
+            complex.resize(std::size_t(nx/2 + 1) * ny);
+            green.resize(complex.size());
+
+            // FFTW is row-major, so the x index, which runs fastest, comes last
+            auto * const c = reinterpret_cast<FFTWComplex *>(complex.data());
+            forward = plan_r2c(ny, nx, real.data(), c, FFTW_ESTIMATE);
+            backward = plan_c2r(ny, nx, c, real.data(), FFTW_ESTIMATE);
+        }
+
+        ~FFT ()
+        {
+            destroy_plan(forward);
+            destroy_plan(backward);
+        }
+
+        FFT (FFT const &) = delete;
+        FFT & operator= (FFT const &) = delete;
+
+        std::vector<amrex::Real> real; //! padded real data, rho and phi
+        std::vector<std::complex<amrex::Real>> complex; //! Fourier transform of the padded data
+        std::vector<std::complex<amrex::Real>> green; //! scaled Fourier transform of the Green's function
+        Plan forward; //! real to complex in place of real and complex
+        Plan backward; //! complex to real in place of complex and real
+    };
+
+    IntegratedGreenFunction2D::IntegratedGreenFunction2D () = default;
+
+    IntegratedGreenFunction2D::~IntegratedGreenFunction2D () = default;
+
+    void
+    IntegratedGreenFunction2D::update_green_function ()
+    {
+        BL_PROFILE("impactx::spacecharge::IntegratedGreenFunction2D::update_green_function");
+
+        // 1 / (2 pi epsilon0) in V m / C
+        constexpr double coulomb2d = 2.0 * 8.9875517923e9;
+
+        int const nx = 2 * m_n[0];
+        int const ny = 2 * m_n[1];
+        std::array<double, 2> const dx = {double(m_dx[0]), double(m_dx[1])};
+
+        // Green's function at the cyclic offsets of the padded grid: the
+        // upper half of each direction holds the negative offsets
+        std::vector<amrex::Real> & g = m_fft->real;
+        for (int j = 0; j < ny; ++j) {
+            double const y = (j < m_n[1] ? j : j - ny) * dx[1];
+            for (int i = 0; i < nx; ++i) {
+                double const x = (i < m_n[0] ? i : i - nx) * dx[0];
+                g[i + std::size_t(nx) * j] = amrex::Real(integrated_green_function(x, y, dx));
+            }
+        }
+        execute(m_fft->forward);
+
+        // include 1 / (2 pi epsilon0) and the normalization of the inverse FFT
+        amrex::Real const scale = amrex::Real(coulomb2d / (double(nx) * ny));
+        std::transform(m_fft->complex.begin(), m_fft->complex.end(), m_fft->green.begin(),
+                       [scale](std::complex<amrex::Real> const & c){ return scale * c; });
+
+        ++m_num_green_functions;
+    }
+
+    void
+    IntegratedGreenFunction2D::solve (std::array<int, 2> const & n,
+                                      std::array<amrex::Real, 2> const & dx,
+                                      amrex::Real const * rho,
+                                      amrex::Real * phi)
+    {
+        BL_PROFILE("impactx::spacecharge::IntegratedGreenFunction2D::solve");
+
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(n[0] > 0 && n[1] > 0,
+            "IntegratedGreenFunction2D: the grid has no nodes!");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(dx[0] > 0 && dx[1] > 0,
+            "IntegratedGreenFunction2D: the cell size must be positive!");
+
+        // the plans depend on the number of nodes, the Green's function also on the cell size
+        if (!m_fft || n != m_n)
+        {
+            m_fft.reset();
+            m_fft = std::make_unique<FFT>(n);
+            m_n = n;
+            m_dx = {0, 0};
+        }
+        if (dx != m_dx)
+        {
+            m_dx = dx;
+            update_green_function();
+        }
+
+        int const nx = 2 * n[0];
+        std::size_t const sx = n[0];
+
+        // zero-padded charge density
+        std::vector<amrex::Real> & data = m_fft->real;
+        std::fill(data.begin(), data.end(), amrex::Real(0));
+        for (int j = 0; j < n[1]; ++j) {
+            std::copy_n(rho + j*sx, n[0], data.begin() + std::size_t(nx) * j);
+        }
+
+        // convolution with the Green's function
+        execute(m_fft->forward);
+        std::transform(m_fft->complex.begin(), m_fft->complex.end(), m_fft->green.begin(),
+                       m_fft->complex.begin(), std::multiplies<>());
+        execute(m_fft->backward);
+
+        // the potential on the nodes of the unpadded grid
+        for (int j = 0; j < n[1]; ++j) {
+            std::copy_n(data.begin() + std::size_t(nx) * j, n[0], phi + j*sx);
+        }
+    }
+
+} // namespace impactx::spacecharge
@@ -0,0 +1,149 @@
+/* Copyright 2022 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl, Chad Mitchell, Ji Qiang
+ * License: BSD-3-Clause-LBNL
+ */
+#include "PoissonSolve.H"
+
+#include <AMReX_BLassert.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_Box.H>
+#include <AMReX_BoxArray.H>
+#include <AMReX_BoxList.H>
+#include <AMReX_DistributionMapping.H>
+#include <AMReX_IntVect.H>
+#include <AMReX_Loop.H>
+#include <AMReX_MFIter.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_Vector.H>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+
+namespace impactx::spacecharge
+{
+    void
+    PoissonSolve (ImpactXParticleContainer const & pc,
+                  std::unordered_map<int, amrex::MultiFab> const & rho,
+                  std::unordered_map<int, amrex::MultiFab> & phi,
+                  std::unordered_map<int, amrex::MultiFab> & space_charge_field,
+                  IntegratedGreenFunction & solver)
+    {
+        BL_PROFILE("impactx::spacecharge::PoissonSolve");
+
+        using namespace amrex::literals; // for _rt and _prt
+
+        // only a single level is solved: fine levels would need the coarse
+        // potential as their boundary condition
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(pc.finestLevel() == 0,
+            "PoissonSolve: mesh refinement is not yet supported!");
+        int const lev = 0;
+
+        amrex::MultiFab const & rho_at_level = rho.at(lev);
+        amrex::Geometry const & gm = pc.Geom(lev);
+
+        // the nodes of the domain
+        amrex::Box const nodes = amrex::convert(gm.Domain(), amrex::IntVect::TheNodeVector());
+        std::array<int, 3> const n = {nodes.length(0), nodes.length(1), nodes.length(2)};
+
+        // the FFTs are distributed in slabs of planes in z: one box per MPI
+        // rank with a non-empty slab
+        std::array<int, 2> const slab = solver.local_slab(n);
+        int const nranks = amrex::ParallelDescriptor::NProcs();
+        amrex::Vector<int> slabs(2 * nranks);
+        amrex::ParallelAllGather::AllGather(slab.data(), 2, slabs.data(),
+                                            amrex::ParallelDescriptor::Communicator());
+        amrex::BoxList slab_boxes(amrex::IndexType::TheNodeType());
+        amrex::Vector<int> slab_ranks;
+        for (int rank = 0; rank < nranks; ++rank)
+        {
+            int const begin = slabs[2 * rank];
+            int const size = slabs[2 * rank + 1];
+            if (size == 0) { continue; }
+            amrex::Box box = nodes;
+            box.setSmall(2, nodes.smallEnd(2) + begin);
+            box.setBig(2, nodes.smallEnd(2) + begin + size - 1);
+            slab_boxes.push_back(box);
+            slab_ranks.push_back(rank);
+        }
+        amrex::BoxArray const ba_slab(slab_boxes);
+        amrex::DistributionMapping const dm_slab(slab_ranks);
+
+        // the charge density of the domain: guard nodes of the boxes were
+        // summed into the nodes of their neighbors during the deposition
+        amrex::MultiFab rho_slab(ba_slab, dm_slab, 1, 0);
+        rho_slab.setVal(0.0_rt);
+        rho_slab.ParallelCopy(rho_at_level, 0, 0, 1);
+
+        // the mesh keeps all particles one cell inside of the domain, so that
+        // no charge is deposited on guard nodes outside of it, \see ResizeMesh
+        amrex::Real const cell_volume = gm.CellSize(0) * gm.CellSize(1) * gm.CellSize(2);
+        amrex::Real const mesh_charge = rho_slab.sum(0) * cell_volume;
+        amrex::Real const beam_charge = pc.GetRefParticle().charge * pc.TotalWeight();
+        amrex::Real const charge_tolerance = std::sqrt(std::numeric_limits<amrex::Real>::epsilon());
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
+            std::abs(mesh_charge - beam_charge) <= charge_tolerance * std::abs(beam_charge),
+            "PoissonSolve: the charge on the mesh differs from the charge of the beam!");
+
+        // rest frame of the reference particle
+        amrex::Real const gamma = pc.GetRefParticle().gamma();
+        std::array<amrex::Real, 3> const dr = {gm.CellSize(0), gm.CellSize(1), gamma * gm.CellSize(2)};
+
+        // solve in place of rho, on all MPI ranks together
+        amrex::Real * rho_phi = nullptr;
+        for (amrex::MFIter mfi(rho_slab); mfi.isValid(); ++mfi)
+        {
+            rho_phi = rho_slab[mfi].dataPtr();
+        }
+        solver.solve(n, dr, rho_phi, rho_phi);
+
+        // the charge density in the rest frame is lower by gamma; one guard
+        // plane in z for the gradient across the slabs
+        amrex::MultiFab phi_slab(ba_slab, dm_slab, 1, amrex::IntVect(0, 0, 1));
+        phi_slab.setVal(0.0_rt);
+        amrex::MultiFab::Copy(phi_slab, rho_slab, 0, 0, 1, 0);
+        phi_slab.mult(1.0_rt / gamma, 0, 1, 0);
+        phi_slab.FillBoundary();
+
+        // E = -grad(phi), one-sided on the outermost nodes of the domain
+        amrex::MultiFab field_slab(ba_slab, dm_slab, 3, 0);
+        amrex::Dim3 const lo = amrex::lbound(nodes);
+        amrex::Dim3 const hi = amrex::ubound(nodes);
+        for (amrex::MFIter mfi(field_slab); mfi.isValid(); ++mfi)
+        {
+            amrex::Array4<amrex::Real const> const phi_arr = phi_slab.const_array(mfi);
+            amrex::Array4<amrex::Real> const field_arr = field_slab.array(mfi);
+
+            amrex::LoopOnCpu(mfi.validbox(), [&](int i, int j, int k) {
+                int const im = std::max(i - 1, lo.x);
+                int const ip = std::min(i + 1, hi.x);
+                int const jm = std::max(j - 1, lo.y);
+                int const jp = std::min(j + 1, hi.y);
+                int const km = std::max(k - 1, lo.z);
+                int const kp = std::min(k + 1, hi.z);
+                field_arr(i, j, k, 0) = -(phi_arr(ip, j, k) - phi_arr(im, j, k)) / ((ip - im) * dr[0]);
+                field_arr(i, j, k, 1) = -(phi_arr(i, jp, k) - phi_arr(i, jm, k)) / ((jp - jm) * dr[1]);
+                field_arr(i, j, k, 2) = -(phi_arr(i, j, kp) - phi_arr(i, j, km)) / ((kp - km) * dr[2]);
+            });
+        }
+
+        // distribute to the boxes of all MPI ranks, including their guard
+        // nodes; guard nodes outside of the domain are zero
+        amrex::MultiFab & phi_at_level = phi.at(lev);
+        amrex::MultiFab & field_at_level = space_charge_field.at(lev);
+        phi_at_level.setVal(0.0_rt);
+        field_at_level.setVal(0.0_rt);
+        phi_at_level.ParallelCopy(phi_slab, 0, 0, 1,
+                                  amrex::IntVect(0), phi_at_level.nGrowVect());
+        field_at_level.ParallelCopy(field_slab, 0, 0, 3,
+                                    amrex::IntVect(0), field_at_level.nGrowVect());
+    }
+
+} // namespace impactx::spacecharge
@@ -0,0 +1,339 @@
+/* Copyright 2022 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl, Chad Mitchell, Ji Qiang
+ * License: BSD-3-Clause-LBNL
+ */
+#include "SpaceCharge2p5D.H"
+#include "ShapeFactor.H"
+#include "particles/transformation/ToFixedT.H"
+
+#include <AMReX.H>
+#include <AMReX_Array.H>
+#include <AMReX_BLassert.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_Extension.H>
+#include <AMReX_GpuAtomic.H>
+#include <AMReX_GpuLaunch.H>
+#include <AMReX_GpuQualifiers.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_REAL.H>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+
+namespace impactx::spacecharge
+{
+namespace
+{
+    /** Nodes of the transverse grid and the longitudinal histogram
+     *
+     * The node of index zero is num_guards nodes below the lower corner of
+     * the domain, so that the shape factors of all particles in the domain
+     * fall on nodes of the grid.
+     */
+    struct Grid2p5D
+    {
+        amrex::GpuArray<amrex::Real, 3> plo; //! position of the node of index zero
+        amrex::GpuArray<amrex::Real, 3> dxi; //! inverse cell size
+        amrex::GpuArray<int, 3> n; //! number of nodes
+    };
+
+    /** Deposit the charge of the particles of one box
+     *
+     * @tparam order order of the particle shape, 1, 2 or 3
+     * @param pti the particle box
+     * @param grid the nodes of the transverse grid and the histogram
+     * @param to_t the transformation of the particles to fixed t
+     * @param charge charge of one real particle (C)
+     * @param[in,out] rho transverse charge density, integrated over z (C/m^2)
+     * @param[in,out] lambda line density (C/m)
+     */
+    template <int order>
+    void
+    deposit (ImpactXParticleContainer::iterator & pti,
+             Grid2p5D const & grid,
+             transformation::ToFixedT const & to_t,
+             amrex::Real const charge,
+             amrex::Real * const AMREX_RESTRICT rho,
+             amrex::Real * const AMREX_RESTRICT lambda)
+    {
+        int const np = pti.numParticles();
+
+        // preparing access to particle data: AoS
+        using PType = ImpactXParticleContainer::ParticleType;
+        auto & aos = pti.GetArrayOfStructs();
+        PType const * const AMREX_RESTRICT aos_ptr = aos().dataPtr();
+
+        // preparing access to particle data: SoA of Reals
+        auto & soa_real = pti.GetStructOfArrays().GetRealData();
+        amrex::ParticleReal const * const AMREX_RESTRICT part_px = soa_real[RealSoA::ux].dataPtr();
+        amrex::ParticleReal const * const AMREX_RESTRICT part_py = soa_real[RealSoA::uy].dataPtr();
+        amrex::ParticleReal const * const AMREX_RESTRICT part_pt = soa_real[RealSoA::pt].dataPtr();
+        amrex::ParticleReal const * const AMREX_RESTRICT part_w = soa_real[RealSoA::w].dataPtr();
+
+        amrex::Real const rho_scale = charge * grid.dxi[0] * grid.dxi[1];
+        amrex::Real const lambda_scale = charge * grid.dxi[2];
+        int const nx = grid.n[0];
+
+        amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (long i)
+        {
+            PType const & p = aos_ptr[i];
+
+            // position at fixed t
+            amrex::Real x = p.pos(RealAoS::x);
+            amrex::Real y = p.pos(RealAoS::y);
+            amrex::Real z = p.pos(RealAoS::z);
+            amrex::Real px = part_px[i];
+            amrex::Real py = part_py[i];
+            amrex::Real pz = part_pt[i];
+            to_t(x, y, z, px, py, pz);
+
+            amrex::Real sx[order + 1], sy[order + 1], sz[order + 1];
+            int const i0 = shape_factor<order>(sx, (x - grid.plo[0]) * grid.dxi[0]);
+            int const j0 = shape_factor<order>(sy, (y - grid.plo[1]) * grid.dxi[1]);
+            int const k0 = shape_factor<order>(sz, (z - grid.plo[2]) * grid.dxi[2]);
+
+            for (int jy = 0; jy <= order; ++jy) {
+                for (int ix = 0; ix <= order; ++ix) {
+                    amrex::HostDevice::Atomic::Add(&rho[(i0 + ix) + nx * (j0 + jy)],
+                                                   rho_scale * part_w[i] * sx[ix] * sy[jy]);
+                }
+            }
+            for (int kz = 0; kz <= order; ++kz) {
+                amrex::HostDevice::Atomic::Add(&lambda[k0 + kz],
+                                               lambda_scale * part_w[i] * sz[kz]);
+            }
+        });
+    }
+
+    /** Gather the field and kick the particles of one box
+     *
+     * The field is gathered at the position of the particles at fixed t,
+     * but the kick of px and py at fixed t is applied to the particles in
+     * x, y, t coordinates at fixed s. With the momenta in units of mc and
+     * E = ptd + pt = -gamma, a particle is at x + px t / E at fixed t, so
+     * a kick dpx, dpy at fixed t changes x, y, t and E to
+     *   x - dpx t / E, y - dpy t / E, t E' / E and
+     *   E' = -sqrt(E^2 + dpx (2 px + dpx) + dpy (2 py + dpy)).
+     * This is ToFixedS after the kick, without the rounding of a round
+     * trip through fixed t.
+     *
+     * @tparam order order of the particle shape, 1, 2 or 3
+     * @param pti the particle box
+     * @param grid the nodes of the transverse grid and the histogram
+     * @param to_t the transformation of the particles to fixed t
+     * @param ex transverse field in x per line density (V/C)
+     * @param ey transverse field in y per line density (V/C)
+     * @param lambda line density (C/m)
+     * @param kick_xy momentum kick in x and y per rest frame field (1/(V/m))
+     */
+    template <int order>
+    void
+    gather_and_push (ImpactXParticleContainer::iterator & pti,
+                     Grid2p5D const & grid,
+                     transformation::ToFixedT const & to_t,
+                     amrex::Real const * const AMREX_RESTRICT ex,
+                     amrex::Real const * const AMREX_RESTRICT ey,
+                     amrex::Real const * const AMREX_RESTRICT lambda,
+                     amrex::Real const kick_xy,
+                     RefPart const & ref_part)
+    {
+        using namespace amrex::literals; // for _rt and _prt
+
+        int const np = pti.numParticles();
+
+        // preparing access to particle data: AoS
+        using PType = ImpactXParticleContainer::ParticleType;
+        auto & aos = pti.GetArrayOfStructs();
+        PType * const AMREX_RESTRICT aos_ptr = aos().dataPtr();
+
+        // preparing access to particle data: SoA of Reals
+        auto & soa_real = pti.GetStructOfArrays().GetRealData();
+        amrex::ParticleReal * const AMREX_RESTRICT part_px = soa_real[RealSoA::ux].dataPtr();
+        amrex::ParticleReal * const AMREX_RESTRICT part_py = soa_real[RealSoA::uy].dataPtr();
+        amrex::ParticleReal * const AMREX_RESTRICT part_pt = soa_real[RealSoA::pt].dataPtr();
+
+        int const nx = grid.n[0];
+
+        // reference values: pt = -gamma and pz = beta*gamma
+        amrex::Real const ptd = ref_part.pt;
+        amrex::Real const pzd = ref_part.beta_gamma();
+
+        amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (long i)
+        {
+            PType & p = aos_ptr[i];
+
+            // position at fixed t
+            amrex::Real x = p.pos(RealAoS::x);
+            amrex::Real y = p.pos(RealAoS::y);
+            amrex::Real z = p.pos(RealAoS::z);
+            amrex::Real px = part_px[i];
+            amrex::Real py = part_py[i];
+            amrex::Real pz = part_pt[i];
+            to_t(x, y, z, px, py, pz);
+
+            amrex::Real sx[order + 1], sy[order + 1], sz[order + 1];
+            int const i0 = shape_factor<order>(sx, (x - grid.plo[0]) * grid.dxi[0]);
+            int const j0 = shape_factor<order>(sy, (y - grid.plo[1]) * grid.dxi[1]);
+            int const k0 = shape_factor<order>(sz, (z - grid.plo[2]) * grid.dxi[2]);
+
+            amrex::Real ex_p = 0, ey_p = 0, lambda_p = 0;
+            for (int jy = 0; jy <= order; ++jy) {
+                for (int ix = 0; ix <= order; ++ix) {
+                    amrex::Real const w = sx[ix] * sy[jy];
+                    ex_p += w * ex[(i0 + ix) + nx * (j0 + jy)];
+                    ey_p += w * ey[(i0 + ix) + nx * (j0 + jy)];
+                }
+            }
+            for (int kz = 0; kz <= order; ++kz) {
+                lambda_p += sz[kz] * lambda[k0 + kz];
+            }
+
+            // kick at fixed t, applied at fixed s in units of mc
+            amrex::Real const dpx = pzd * kick_xy * lambda_p * ex_p;
+            amrex::Real const dpy = pzd * kick_xy * lambda_p * ey_p;
+            amrex::Real const px_s = pzd * part_px[i];
+            amrex::Real const py_s = pzd * part_py[i];
+            amrex::Real const energy = ptd + pzd * part_pt[i];
+            amrex::Real const energy_new = -std::sqrt(
+                energy * energy + dpx * (2.0_rt * px_s + dpx) + dpy * (2.0_rt * py_s + dpy));
+            amrex::Real const t = p.pos(RealAoS::z);
+
+            p.pos(RealAoS::x) -= dpx * t / energy;
+            p.pos(RealAoS::y) -= dpy * t / energy;
+            p.pos(RealAoS::z) = t * energy_new / energy;
+            part_px[i] += dpx / pzd;
+            part_py[i] += dpy / pzd;
+            part_pt[i] = (energy_new - ptd) / pzd;
+        });
+    }
+
+    /** Call a kernel templated on the particle shape
+     *
+     * @param shape order of the particle shape, algo.particle_shape
+     * @param f generic lambda that takes std::integral_constant<int, order>
+     */
+    template <typename F>
+    void
+    dispatch_shape (int const shape, F && f)
+    {
+        if (shape == 1) {
+            f(std::integral_constant<int, 1>{});
+        } else if (shape == 2) {
+            f(std::integral_constant<int, 2>{});
+        } else if (shape == 3) {
+            f(std::integral_constant<int, 3>{});
+        } else {
+            amrex::Abort("SpaceCharge2p5D: algo.particle_shape must be 1, 2 or 3!");
+        }
+    }
+} // namespace
+
+    void
+    SpaceCharge2p5D (ImpactXParticleContainer & pc,
+                     amrex::Real const ds,
+                     IntegratedGreenFunction2D & solver)
+    {
+        BL_PROFILE("impactx::spacecharge::SpaceCharge2p5D");
+
+        using namespace amrex::literals; // for _rt and _prt
+
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(pc.finestLevel() == 0,
+            "SpaceCharge2p5D: mesh refinement is not yet supported!");
+        int const lev = 0;
+
+        // the nodes of the mesh, with guard nodes for the particle shape
+        int const shape = pc.GetParticleShape();
+        int const num_guards = shape % 2 == 0 ? shape / 2 + 1 : (shape + 1) / 2;
+        amrex::Geometry const & gm = pc.Geom(lev);
+        Grid2p5D grid;
+        for (int d = 0; d < 3; ++d)
+        {
+            grid.n[d] = gm.Domain().length(d) + 1 + 2 * num_guards;
+            grid.dxi[d] = gm.InvCellSize(d);
+            grid.plo[d] = gm.ProbLo(d) - num_guards * gm.CellSize(d);
+        }
+        std::size_t const n_xy = std::size_t(grid.n[0]) * grid.n[1];
+
+        // the particles stay at fixed s and are transformed to fixed t on the fly
+        RefPart const ref_part = pc.GetRefParticle();
+        transformation::ToFixedT const to_t(ref_part.pt);
+
+        // transverse charge density and line density in one buffer, for a
+        // single sum over all MPI ranks
+        std::vector<amrex::Real> charge(n_xy + grid.n[2], 0.0_rt);
+        amrex::Real * const rho = charge.data();
+        amrex::Real * const lambda = charge.data() + n_xy;
+
+        using ParIt = ImpactXParticleContainer::iterator;
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+        for (ParIt pti(pc, lev); pti.isValid(); ++pti)
+        {
+            dispatch_shape(shape, [&](auto order){
+                deposit<decltype(order)::value>(pti, grid, to_t, ref_part.charge, rho, lambda);
+            });
+        }
+        amrex::ParallelDescriptor::ReduceRealSum(charge.data(), int(charge.size()));
+
+        // total charge: the shape factors of each particle sum to one
+        amrex::Real total_charge = 0.0_rt;
+        for (int k = 0; k < grid.n[2]; ++k) {
+            total_charge += lambda[k];
+        }
+        total_charge *= gm.CellSize(2);
+        if (total_charge == 0.0_rt) {
+            return;
+        }
+
+        // potential of the transverse charge density of the whole beam
+        std::vector<amrex::Real> phi(n_xy);
+        std::array<int, 2> const n = {grid.n[0], grid.n[1]};
+        std::array<amrex::Real, 2> const dx = {gm.CellSize(0), gm.CellSize(1)};
+        solver.solve(n, dx, rho, phi.data());
+
+        // E = -grad(phi), one-sided on the outermost nodes; per line density,
+        // in the rest frame of the reference particle, where the line density
+        // is lower by gamma
+        amrex::Real const scale = 1.0_rt / (ref_part.gamma() * total_charge);
+        std::vector<amrex::Real> ex(n_xy), ey(n_xy);
+        for (int j = 0; j < n[1]; ++j)
+        {
+            int const jm = std::max(j - 1, 0);
+            int const jp = std::min(j + 1, n[1] - 1);
+            for (int i = 0; i < n[0]; ++i)
+            {
+                int const im = std::max(i - 1, 0);
+                int const ip = std::min(i + 1, n[0] - 1);
+                ex[i + n[0]*j] = -scale * (phi[ip + n[0]*j] - phi[im + n[0]*j]) / ((ip - im) * dx[0]);
+                ey[i + n[0]*j] = -scale * (phi[i + n[0]*jp] - phi[i + n[0]*jm]) / ((jp - jm) * dx[1]);
+            }
+        }
+
+        // momentum kick per rest frame field, \see GatherAndPush
+        amrex::Real const bg = ref_part.beta_gamma();
+        amrex::Real const kick_xy = ref_part.charge_qe() * ds /
+                                    (ref_part.mass_MeV() * 1.0e6_rt * bg * bg);
+
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+        for (ParIt pti(pc, lev); pti.isValid(); ++pti)
+        {
+            dispatch_shape(shape, [&](auto order){
+                gather_and_push<decltype(order)::value>(pti, grid, to_t, ex.data(), ey.data(), lambda,
+                                                        kick_xy, ref_part);
+            });
+        }
+    }
+
+} // namespace impactx::spacecharge
@@ -14,7 +14,9 @@
 
 #include <AMReX_BLProfiler.H> // for BL_PROFILE
 #include <AMReX_Extension.H>  // for AMREX_RESTRICT
-#include <AMReX_REAL.H>       // for ParticleReal
+#include <AMReX_ParallelDescriptor.H> // for ReduceRealMin
+#include <AMReX_REAL.H>       // for ParticleReal, Real
+#include <AMReX_Reduce.H>     // for ReduceOps, ReduceData
 
 #include <cmath>
 
@@ -22,6 +24,97 @@
 namespace impactx
 {
 namespace transformation {
+namespace
+{
+    /** Extent of the particles at fixed t
+     *
+     * @tparam store_fixed_t also store the particles in x, y, z coordinates
+     * @param pc container of the particles, in x, y, t coordinates
+     * @returns x_min, y_min, z_min, x_max, y_max, z_max at fixed t
+     */
+    template <bool store_fixed_t>
+    std::tuple<
+        amrex::ParticleReal, amrex::ParticleReal,
+        amrex::ParticleReal, amrex::ParticleReal,
+        amrex::ParticleReal, amrex::ParticleReal>
+    min_and_max_at_fixed_t (ImpactXParticleContainer &pc)
+    {
+        // preparing to access reference particle data: RefPart
+        RefPart ref_part = pc.GetRefParticle();
+        amrex::Real const ptd = ref_part.pt;  // Design value of pt/mc2 = -gamma.
+        ToFixedT const to_t(ptd);
+
+        // the max is reduced as the min of the negative position
+        amrex::ReduceOps<amrex::ReduceOpMin, amrex::ReduceOpMin, amrex::ReduceOpMin,
+                         amrex::ReduceOpMin, amrex::ReduceOpMin, amrex::ReduceOpMin> reduce_ops;
+        amrex::ReduceData<amrex::Real, amrex::Real, amrex::Real,
+                          amrex::Real, amrex::Real, amrex::Real> reduce_data(reduce_ops);
+        using ReduceTuple = typename decltype(reduce_data)::Type;
+
+        // loop over refinement levels
+        int const nLevel = pc.finestLevel();
+        for (int lev = 0; lev <= nLevel; ++lev) {
+            // loop over all particle boxes
+            using ParIt = ImpactXParticleContainer::iterator;
+            for (ParIt pti(pc, lev); pti.isValid(); ++pti) {
+                const int np = pti.numParticles();
+
+                // preparing access to particle data: AoS
+                using PType = ImpactXParticleContainer::ParticleType;
+                auto &aos = pti.GetArrayOfStructs();
+                PType *AMREX_RESTRICT aos_ptr = aos().dataPtr();
+
+                // preparing access to particle data: SoA of Reals
+                auto &soa_real = pti.GetStructOfArrays().GetRealData();
+                amrex::ParticleReal *const AMREX_RESTRICT part_px = soa_real[RealSoA::ux].dataPtr();
+                amrex::ParticleReal *const AMREX_RESTRICT part_py = soa_real[RealSoA::uy].dataPtr();
+                amrex::ParticleReal *const AMREX_RESTRICT part_pt = soa_real[RealSoA::pt].dataPtr();
+
+                reduce_ops.eval(np, reduce_data,
+                    [=] AMREX_GPU_DEVICE (int i) -> ReduceTuple
+                    {
+                        // access AoS data such as positions and cpu/id
+                        PType &p = aos_ptr[i];
+                        amrex::Real x = p.pos(RealAoS::x);
+                        amrex::Real y = p.pos(RealAoS::y);
+                        amrex::Real t = p.pos(RealAoS::z);
+
+                        // access SoA Real data
+                        amrex::Real px = part_px[i];
+                        amrex::Real py = part_py[i];
+                        amrex::Real pt = part_pt[i];
+
+                        to_t(x, y, t, px, py, pt);
+
+                        if constexpr (store_fixed_t) {
+                            // store particle data in the (possibly lower) particle precision
+                            p.pos(RealAoS::x) = x;
+                            p.pos(RealAoS::y) = y;
+                            p.pos(RealAoS::z) = t;
+                            part_px[i] = px;
+                            part_py[i] = py;
+                            part_pt[i] = pt;
+
+                            // extent of the stored positions
+                            x = p.pos(RealAoS::x);
+                            y = p.pos(RealAoS::y);
+                            t = p.pos(RealAoS::z);
+                        }
+                        return {x, y, t, -x, -y, -t};
+                    });
+            } // end loop over all particle boxes
+        } // env mesh-refinement level loop
+
+        ReduceTuple const r = reduce_data.value(reduce_ops);
+        amrex::Real min_neg_max[6] = {amrex::get<0>(r), amrex::get<1>(r), amrex::get<2>(r),
+                                      amrex::get<3>(r), amrex::get<4>(r), amrex::get<5>(r)};
+        amrex::ParallelDescriptor::ReduceRealMin(min_neg_max, 6);
+
+        return {min_neg_max[0], min_neg_max[1], min_neg_max[2],
+                -min_neg_max[3], -min_neg_max[4], -min_neg_max[5]};
+    }
+} // namespace
+
     void CoordinateTransformation (ImpactXParticleContainer &pc,
                                    Direction const &direction)
    {
@@ -30,13 +123,16 @@ namespace transformation {
 
         // preparing to access reference particle data: RefPart
         RefPart ref_part = pc.GetRefParticle();
-        amrex::ParticleReal const pd = ref_part.pt;  // Design value of pt/mc2 = -gamma
+        amrex::Real const pd = ref_part.pt;  // Design value of pt/mc2 = -gamma
 
         // loop over refinement levels
         int const nLevel = pc.finestLevel();
         for (int lev = 0; lev <= nLevel; ++lev) {
             // loop over all particle boxes
             using ParIt = ImpactXParticleContainer::iterator;
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
             for (ParIt pti(pc, lev); pti.isValid(); ++pti) {
                 const int np = pti.numParticles();
 
@@ -54,38 +150,82 @@ namespace transformation {
                 if( direction == Direction::to_fixed_s) {
                     BL_PROFILE("impactx::transformation::CoordinateTransformation::to_fixed_s");
                     // Design value of pz/mc = beta*gamma
-                    amrex::ParticleReal const pzd = sqrt(pow(pd, 2) - 1.0);
+                    amrex::Real const pzd = sqrt(pow(pd, 2) - 1.0);
 
                     ToFixedS const to_s(pzd);
                     amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE(long i) {
                         // access AoS data such as positions and cpu/id
                         PType &p = aos_ptr[i];
+                        amrex::Real x = p.pos(RealAoS::x);
+                        amrex::Real y = p.pos(RealAoS::y);
+                        amrex::Real t = p.pos(RealAoS::z);
 
                         // access SoA Real data
-                        amrex::ParticleReal &px = part_px[i];
-                        amrex::ParticleReal &py = part_py[i];
-                        amrex::ParticleReal &pz = part_pt[i];
+                        amrex::Real px = part_px[i];
+                        amrex::Real py = part_py[i];
+                        amrex::Real pz = part_pt[i];
 
-                        to_s(p, px, py, pz);
+                        to_s(x, y, t, px, py, pz);
+
+                        // store particle data in the (possibly lower) particle precision
+                        p.pos(RealAoS::x) = x;
+                        p.pos(RealAoS::y) = y;
+                        p.pos(RealAoS::z) = t;
+                        part_px[i] = px;
+                        part_py[i] = py;
+                        part_pt[i] = pz;
                     });
                 } else {
                     BL_PROFILE("impactx::transformation::CoordinateTransformation::to_fixed_t");
-                    amrex::ParticleReal const ptd = pd;  // Design value of pt/mc2 = -gamma.
+                    amrex::Real const ptd = pd;  // Design value of pt/mc2 = -gamma.
                     ToFixedT const to_t(ptd);
                     amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE(long i) {
                         // access AoS data such as positions and cpu/id
                         PType &p = aos_ptr[i];
+                        amrex::Real x = p.pos(RealAoS::x);
+                        amrex::Real y = p.pos(RealAoS::y);
+                        amrex::Real t = p.pos(RealAoS::z);
 
                         // access SoA Real data
-                        amrex::ParticleReal &px = part_px[i];
-                        amrex::ParticleReal &py = part_py[i];
-                        amrex::ParticleReal &pt = part_pt[i];
+                        amrex::Real px = part_px[i];
+                        amrex::Real py = part_py[i];
+                        amrex::Real pt = part_pt[i];
+
+                        to_t(x, y, t, px, py, pt);
 
-                        to_t(p, px, py, pt);
+                        // store particle data in the (possibly lower) particle precision
+                        p.pos(RealAoS::x) = x;
+                        p.pos(RealAoS::y) = y;
+                        p.pos(RealAoS::z) = t;
+                        part_px[i] = px;
+                        part_py[i] = py;
+                        part_pt[i] = pt;
                     });
                 }
             } // end loop over all particle boxes
         } // env mesh-refinement level loop
     }
+
+    std::tuple<
+        amrex::ParticleReal, amrex::ParticleReal,
+        amrex::ParticleReal, amrex::ParticleReal,
+        amrex::ParticleReal, amrex::ParticleReal>
+    ToFixedTAndMinMax (ImpactXParticleContainer &pc)
+    {
+        BL_PROFILE("impactx::transformation::ToFixedTAndMinMax");
+
+        return min_and_max_at_fixed_t<true>(pc);
+    }
+
+    std::tuple<
+        amrex::ParticleReal, amrex::ParticleReal,
+        amrex::ParticleReal, amrex::ParticleReal,
+        amrex::ParticleReal, amrex::ParticleReal>
+    MinAndMaxAtFixedT (ImpactXParticleContainer &pc)
+    {
+        BL_PROFILE("impactx::transformation::MinAndMaxAtFixedT");
+
+        return min_and_max_at_fixed_t<false>(pc);
+    }
 } // namespace transformation
 } // namespace impactx
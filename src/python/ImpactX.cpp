@@ -6,6 +6,7 @@
 #include "pyImpactX.H"
 
 #include <ImpactX.H>
+#include <particles/LinearOptics.H>
 #include <particles/distribution/Gaussian.H>
 #include <particles/distribution/Kurth4D.H>
 #include <particles/distribution/Kurth6D.H>
@@ -16,6 +17,13 @@
 #include <AMReX.H>
 #include <AMReX_ParmParse.H>
 
+#include <pybind11/numpy.h>
+
+#include <array>
+#include <optional>
+#include <string>
+#include <vector>
+
 #if defined(AMREX_DEBUG) || defined(DEBUG)
 #   include <cstdio>
 #endif
@@ -73,6 +81,90 @@ void init_ImpactX(py::module& m)
              py::arg("enable"),
              "Enable or disable space charge calculations (default: enabled)."
         )
+        .def("set_space_charge",
+             [](ImpactX & /* ix */, std::string const & model) {
+                 amrex::ParmParse pp_algo("algo");
+                 pp_algo.add("space_charge", model);
+             },
+             py::arg("model"),
+             "Space charge model: \"false\", \"3D\" or \"2.5D\" (default: \"3D\")."
+        )
+        .def("set_n_cell",
+             [](ImpactX & /* ix */, std::array<int, AMREX_SPACEDIM> const n_cell) {
+                 amrex::ParmParse pp_amr("amr");
+                 pp_amr.addarr("n_cell", std::vector<int>(n_cell.begin(), n_cell.end()));
+             },
+             py::arg("n_cell"),
+             "Number of cells of the space charge mesh in x, y, z. Call before init_grids."
+        )
+        .def("set_space_charge_order",
+             [](ImpactX & /* ix */, int const order) {
+                 amrex::ParmParse pp_algo("algo");
+                 pp_algo.add("space_charge_order", order);
+             },
+             py::arg("order"),
+             "Order of the splitting of space charge kicks and slice maps: 1, 2 or 4\n"
+             "(default: 1 for particle tracking, 2 for envelope tracking)."
+        )
+        .def("set_track",
+             [](ImpactX & /* ix */, std::string const track) {
+                 amrex::ParmParse pp_algo("algo");
+                 pp_algo.add("track", track);
+             },
+             py::arg("track"),
+             "Track beam particles (\"particles\", default) or the beam envelope (\"envelope\")."
+        )
+        .def("set_fuse_elements",
+             [](ImpactX & /* ix */, bool const enable) {
+                 amrex::ParmParse pp_algo("algo");
+                 pp_algo.add("fuse_elements", enable);
+             },
+             py::arg("enable"),
+             "Push consecutive elements without collective effects in a single kernel (default: disabled)."
+        )
+        .def("set_slice_tolerance",
+             [](ImpactX & /* ix */, amrex::Real const tolerance, int const max_nslice) {
+                 amrex::ParmParse pp_algo("algo");
+                 pp_algo.add("slice_tolerance", tolerance);
+                 pp_algo.add("max_nslice", max_nslice);
+             },
+             py::arg("tolerance"), py::arg("max_nslice")=100,
+             "Choose the number of space charge slices per element from the beam, with this\n"
+             "maximum relative change of the rms beam sizes per slice (default: 0, disabled)."
+        )
+        .def("set_mesh_resize_tolerance",
+             [](ImpactX & /* ix */, amrex::Real const tolerance) {
+                 amrex::ParmParse pp_algo("algo");
+                 pp_algo.add("mesh_resize_tolerance", tolerance);
+             },
+             py::arg("tolerance"),
+             "Keep the space charge mesh while it fits the beam and its cells are at most this\n"
+             "relative tolerance larger than after a resize (default: 0, resize every step)."
+        )
+        .def("set_compose_linear_maps",
+             [](ImpactX & /* ix */, bool const enable) {
+                 amrex::ParmParse pp_algo("algo");
+                 pp_algo.add("compose_linear_maps", enable);
+             },
+             py::arg("enable"),
+             "Compose runs of linear elements into single transfer matrices (default: disabled)."
+        )
+        .def("set_taylor_map_order",
+             [](ImpactX & /* ix */, int const order) {
+                 amrex::ParmParse pp_algo("algo");
+                 pp_algo.add("taylor_map_order", order);
+             },
+             py::arg("order"),
+             "Push each lattice period with the truncated Taylor map of this order (default: 0, disabled)."
+        )
+        .def("set_periods",
+             [](ImpactX & /* ix */, int const periods) {
+                 amrex::ParmParse pp_lattice("lattice");
+                 pp_lattice.add("periods", periods);
+             },
+             py::arg("periods"),
+             "The number of periods to track through the lattice, e.g., turns in a ring (default: 1)."
+        )
         .def("set_diagnostics",
              [](ImpactX & /* ix */, bool const enable) {
                  amrex::ParmParse pp_diag("diag");
@@ -92,6 +184,14 @@ void init_ImpactX(py::module& m)
              "By default, diagnostics is performed at the beginning and end of the simulation.\n"
              "Enabling this flag will write diagnostics every step and slice step."
          )
+        .def("set_diag_period_interval",
+             [](ImpactX & /* ix */, int const period_interval) {
+                 amrex::ParmParse pp_diag("diag");
+                 pp_diag.add("period_interval", period_interval);
+             },
+             py::arg("period_interval"),
+             "Write diagnostics at the end of every n-th lattice period (default: 0, disabled)."
+         )
         .def("set_diag_file_min_digits",
              [](ImpactX & /* ix */, int const file_min_digits) {
                  amrex::ParmParse pp_diag("diag");
@@ -116,6 +216,86 @@ void init_ImpactX(py::module& m)
              "distribution's extent and then redistribute particles in according\n"
              "AMReX grid boxes."
         )
+        .def("init_envelope",
+             [](ImpactX & ix,
+                amrex::Real const sigx, amrex::Real const sigy, amrex::Real const sigt,
+                amrex::Real const sigpx, amrex::Real const sigpy, amrex::Real const sigpt,
+                amrex::Real const muxpx, amrex::Real const muypy, amrex::Real const mutpt,
+                amrex::Real const current) {
+                 ix.init_envelope(envelope::create_covariance(sigx, sigy, sigt,
+                                                              sigpx, sigpy, sigpt,
+                                                              muxpx, muypy, mutpt),
+                                  current);
+             },
+             py::arg("sigmaX"), py::arg("sigmaY"), py::arg("sigmaT"),
+             py::arg("sigmaPx"), py::arg("sigmaPy"), py::arg("sigmaPt"),
+             py::arg("muxpx")=0.0, py::arg("muypy")=0.0, py::arg("mutpt")=0.0,
+             py::arg("current")=0.0,
+             "Initialize the beam envelope for envelope tracking.\n\n"
+             "The parameters are the same as for the particle distributions.\n"
+             "The beam current (A) is used for linear space charge."
+        )
+        .def("envelope",
+             [](ImpactX const & ix) -> std::optional<std::vector<std::vector<amrex::Real>>> {
+                 if (!ix.m_envelope) { return std::nullopt; }
+                 std::vector<std::vector<amrex::Real>> cm(6, std::vector<amrex::Real>(6));
+                 for (int i = 0; i < 6; ++i) {
+                     for (int j = 0; j < 6; ++j) {
+                         cm[i][j] = (*ix.m_envelope)(i+1, j+1);
+                     }
+                 }
+                 return cm;
+             },
+             "The 6x6 covariance matrix of the beam in envelope tracking, in the order\n"
+             "x, px, y, py, t, pt, or None if the envelope is not initialized."
+        )
+        .def("lattice_optics",
+             [](ImpactX const & ix) {
+                 LinearOptics const optics(ix.m_lattice, ix.m_particle_container->GetRefParticle());
+                 std::vector<LatticeFunctions> const & table = optics.table();
+
+                 // one NumPy array per column of the table
+                 auto const column = [&table](amrex::Real LatticeFunctions::* member) {
+                     py::array_t<amrex::Real> a(static_cast<py::ssize_t>(table.size()));
+                     auto v = a.mutable_unchecked<1>();
+                     for (py::ssize_t i = 0; i < a.size(); ++i) { v(i) = table[i].*member; }
+                     return a;
+                 };
+                 py::dict d;
+                 d["s"] = column(&LatticeFunctions::s);
+                 d["beta_x"] = column(&LatticeFunctions::beta_x);
+                 d["alpha_x"] = column(&LatticeFunctions::alpha_x);
+                 d["beta_y"] = column(&LatticeFunctions::beta_y);
+                 d["alpha_y"] = column(&LatticeFunctions::alpha_y);
+                 d["dispersion_x"] = column(&LatticeFunctions::dispersion_x);
+                 d["dispersion_px"] = column(&LatticeFunctions::dispersion_px);
+                 d["dispersion_y"] = column(&LatticeFunctions::dispersion_y);
+                 d["dispersion_py"] = column(&LatticeFunctions::dispersion_py);
+                 d["mu_x"] = column(&LatticeFunctions::mu_x);
+                 d["mu_y"] = column(&LatticeFunctions::mu_y);
+                 d["tune_x"] = optics.tune_x();
+                 d["tune_y"] = optics.tune_y();
+                 d["chromaticity_x"] = optics.chromaticity_x();
+                 d["chromaticity_y"] = optics.chromaticity_y();
+
+                 py::array_t<amrex::Real> R({6, 6});
+                 auto r = R.mutable_unchecked<2>();
+                 for (int i = 0; i < 6; ++i) {
+                     for (int j = 0; j < 6; ++j) {
+                         r(i, j) = optics.one_period_map()(i+1, j+1);
+                     }
+                 }
+                 d["one_period_map"] = R;
+                 return d;
+             },
+             "Periodic lattice functions of one lattice period, without tracking.\n\n"
+             "The reference particle and lattice must be initialized. Returns a dict\n"
+             "of NumPy arrays with the values at all element and slice boundaries\n"
+             "(s, beta_x, alpha_x, beta_y, alpha_y, dispersion_x, dispersion_px,\n"
+             "dispersion_y, dispersion_py, mu_x, mu_y), the tunes and chromaticities\n"
+             "(tune_x, tune_y, chromaticity_x, chromaticity_y) and the 6x6\n"
+             "one_period_map."
+        )
         .def("evolve", &ImpactX::evolve,
              "Run the main simulation loop for a number of steps."
         )
@@ -132,10 +312,28 @@ void init_ImpactX(py::module& m)
             py::arg("lev"),
             py::return_value_policy::reference_internal
         )
+        .def(
+            "phi",
+            [](ImpactX & ix, int const lev) { return &ix.m_phi.at(lev); },
+            py::arg("lev"),
+            py::return_value_policy::reference_internal,
+            "Electrostatic potential of the beam in its rest frame (V), see space charge."
+        )
+        .def(
+            "space_charge_field",
+            [](ImpactX & ix, int const lev) { return &ix.m_space_charge_field.at(lev); },
+            py::arg("lev"),
+            py::return_value_policy::reference_internal,
+            "Electric field of the beam in its rest frame (V/m), components x, y, z."
+        )
         .def_readwrite("lattice",
             &ImpactX::m_lattice,
             "Access the accelerator element lattice."
         )
+        .def_readwrite("aperture",
+            &ImpactX::m_aperture,
+            "Optional global aperture, e.g., of the beam pipe, checked after every slice step (default: None)."
+        )
 
         // from AmrCore->AmrMesh
         .def("Geom",
@@ -8,6 +8,10 @@
 #include <particles/elements/All.H>
 #include <AMReX.H>
 
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 namespace py = pybind11;
 using namespace impactx;
 
@@ -64,12 +68,30 @@ void init_elements(py::module& m)
         }, py::keep_alive<0, 1>()) /* Keep list alive while iterator is used */
     ;
 
+    py::class_<Aperture>(me, "Aperture")
+        .def(py::init([](amrex::Real xmax, amrex::Real ymax, std::string const & shape) {
+                 if (shape == "rectangular")
+                     return Aperture(xmax, ymax, Aperture::Shape::rectangular);
+                 else if (shape == "elliptical")
+                     return Aperture(xmax, ymax, Aperture::Shape::elliptical);
+                 else
+                     throw std::runtime_error("Aperture: unknown shape " + shape);
+             }),
+             py::arg("xmax"), py::arg("ymax"), py::arg("shape") = "rectangular",
+             "A thin collimator: particles outside of the aperture are lost."
+        )
+        .def_property_readonly("nslice", &Aperture::nslice)
+        .def_property_readonly("ds", &Aperture::ds)
+        .def_property_readonly("xmax", &Aperture::xmax)
+        .def_property_readonly("ymax", &Aperture::ymax)
+    ;
+
     py::class_<ConstF>(me, "ConstF")
         .def(py::init<
-                amrex::ParticleReal const,
-                amrex::ParticleReal const,
-                amrex::ParticleReal const,
-                amrex::ParticleReal const,
+                amrex::Real const,
+                amrex::Real const,
+                amrex::Real const,
+                amrex::Real const,
                 int const >(),
              py::arg("ds"), py::arg("kx"), py::arg("ky"), py::arg("kt"), py::arg("nslice") = 1,
              "A linear Constant Focusing element."
@@ -80,10 +102,10 @@ void init_elements(py::module& m)
 
     py::class_<DipEdge>(me, "DipEdge")
         .def(py::init<
-                amrex::ParticleReal const,
-                amrex::ParticleReal const,
-                amrex::ParticleReal const,
-                amrex::ParticleReal const>(),
+                amrex::Real const,
+                amrex::Real const,
+                amrex::Real const,
+                amrex::Real const>(),
              py::arg("psi"), py::arg("rc"), py::arg("g"), py::arg("K2"),
              "Edge focusing associated with bend entry or exit."
         )
@@ -93,7 +115,7 @@ void init_elements(py::module& m)
 
     py::class_<Drift>(me, "Drift")
         .def(py::init<
-                amrex::ParticleReal const,
+                amrex::Real const,
                 int const >(),
              py::arg("ds"), py::arg("nslice") = 1,
              "A drift."
@@ -105,8 +127,8 @@ void init_elements(py::module& m)
     py::class_<Multipole>(me, "Multipole")
         .def(py::init<
                 int const,
-                amrex::ParticleReal const,
-                amrex::ParticleReal const>(),
+                amrex::Real const,
+                amrex::Real const>(),
              py::arg("multiple"), py::arg("K_normal"), py::arg("K_skew"),
              "A general thin multipole element."
         )
@@ -124,9 +146,10 @@ void init_elements(py::module& m)
 
     py::class_<NonlinearLens>(me, "NonlinearLens")
         .def(py::init<
-                amrex::ParticleReal const,
-                amrex::ParticleReal const>(),
-             py::arg("knll"), py::arg("cnll"),
+                amrex::Real const,
+                amrex::Real const,
+                amrex::Real const>(),
+             py::arg("knll"), py::arg("cnll"), py::arg("series_tolerance") = 0.0,
              "Single short segment of the nonlinear magnetic insert element."
         )
         .def_property_readonly("nslice", &NonlinearLens::nslice)
@@ -135,8 +158,8 @@ void init_elements(py::module& m)
 
     py::class_<Quad>(me, "Quad")
         .def(py::init<
-                amrex::ParticleReal const,
-                amrex::ParticleReal const,
+                amrex::Real const,
+                amrex::Real const,
                 int const>(),
              py::arg("ds"), py::arg("k"), py::arg("nslice") = 1,
              "A Quadrupole magnet."
@@ -147,8 +170,8 @@ void init_elements(py::module& m)
 
     py::class_<Sbend>(me, "Sbend")
         .def(py::init<
-                amrex::ParticleReal const,
-                amrex::ParticleReal const,
+                amrex::Real const,
+                amrex::Real const,
                 int const>(),
              py::arg("ds"), py::arg("rc"), py::arg("nslice") = 1,
              "An ideal sector bend."
@@ -157,14 +180,58 @@ void init_elements(py::module& m)
         .def_property_readonly("ds", &Sbend::ds)
     ;
 
+    py::class_<RFCavity>(me, "RFCavity")
+        .def(py::init<
+                std::string const &,
+                amrex::Real const,
+                amrex::Real const,
+                amrex::Real const,
+                int const,
+                int const,
+                int const>(),
+             py::arg("field_map"), py::arg("escale"), py::arg("k"), py::arg("phase"),
+             py::arg("nslice") = 1, py::arg("mapsteps") = 1, py::arg("ncoef") = 25,
+             "An RF cavity with a tabulated on-axis field."
+        )
+        .def_property_readonly("nslice", &RFCavity::nslice)
+        .def_property_readonly("ds", &RFCavity::ds)
+    ;
+
     py::class_<ShortRF>(me, "ShortRF")
         .def(py::init<
-                amrex::ParticleReal const,
-                amrex::ParticleReal const>(),
+                amrex::Real const,
+                amrex::Real const>(),
              py::arg("V"), py::arg("k"),
              "A short RF cavity element at zero crossing for bunching."
         )
         .def_property_readonly("nslice", &ShortRF::nslice)
         .def_property_readonly("ds", &ShortRF::ds)
     ;
+
+    py::class_<ThickMultipole>(me, "ThickMultipole")
+        .def(py::init<
+                amrex::Real const,
+                std::vector<amrex::Real> const &,
+                std::vector<amrex::Real> const &,
+                int const,
+                int const,
+                int const>(),
+             py::arg("ds"), py::arg("K_normal"), py::arg("K_skew"), py::arg("nslice") = 1,
+             py::arg("int_order") = 2, py::arg("mapsteps") = 1,
+             "A thick multipole magnet, integrated with a symplectic integrator."
+        )
+        .def_property_readonly("nslice", &ThickMultipole::nslice)
+        .def_property_readonly("ds", &ThickMultipole::ds)
+    ;
+
+    py::class_<ThinMultipole>(me, "ThinMultipole")
+        .def(py::init<
+                std::vector<amrex::Real> const &,
+                std::vector<amrex::Real> const &>(),
+             py::arg("K_normal"), py::arg("K_skew"),
+             "A thin multipole element combining many multipole orders."
+        )
+        .def_property_readonly("nslice", &ThinMultipole::nslice)
+        .def_property_readonly("ds", &ThinMultipole::ds)
+    ;
 }
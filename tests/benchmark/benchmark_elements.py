@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022 ImpactX contributors
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+"""Particle push throughput of the lattice elements.
+
+Tracks a beam through a lattice made of a single element type, without
+space charge and diagnostics, and reports the particle pushes per second
+(particles times element slices per second of wall time).
+
+This only uses the Python API and the elements of the first ImpactX
+releases, so it also runs on older commits. To compare two commits, copy
+this script out of the source tree and run it against each build, e.g.:
+
+    cp tests/benchmark/benchmark_elements.py /tmp/
+    python3 /tmp/benchmark_elements.py --npart 1000000 > after.txt
+    git checkout <baseline>  # rebuild & reinstall
+    python3 /tmp/benchmark_elements.py --npart 1000000 > before.txt
+"""
+
+import argparse
+import time
+
+import amrex
+from impactx import ImpactX, distribution, elements
+
+# one lattice element of each type
+element_types = {
+    "Drift": lambda ns: elements.Drift(ds=0.25, nslice=ns),
+    "Quad": lambda ns: elements.Quad(ds=1.0, k=1.0, nslice=ns),
+    "Sbend": lambda ns: elements.Sbend(ds=0.5, rc=10.0, nslice=ns),
+    "DipEdge": lambda ns: elements.DipEdge(psi=0.048, rc=10.0, g=0.0, K2=0.0),
+    "ConstF": lambda ns: elements.ConstF(ds=1.0, kx=1.0, ky=1.0, kt=1.0, nslice=ns),
+    "ShortRF": lambda ns: elements.ShortRF(V=0.01, k=15.0),
+    "Multipole": lambda ns: elements.Multipole(multiple=3, K_normal=1.0, K_skew=0.0),
+    "NonlinearLens": lambda ns: elements.NonlinearLens(knll=1.0e-6, cnll=0.01),
+}
+
+
+def benchmark(name, npart, nelements, nslice):
+    """Return the particle pushes per second through one element type"""
+    sim = ImpactX()
+
+    sim.set_particle_shape(2)
+    sim.set_space_charge(False)
+    sim.set_diagnostics(False)
+    sim.init_grids()
+
+    #   reference particle: 2 GeV electrons
+    ref = sim.particle_container().ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_energy_MeV(2.0e3)
+
+    #   particle bunch
+    distr = distribution.Waterbag(
+        sigmaX=3.9984884770e-5,
+        sigmaY=3.9984884770e-5,
+        sigmaT=1.0e-3,
+        sigmaPx=2.6623538760e-5,
+        sigmaPy=2.6623538760e-5,
+        sigmaPt=2.0e-3,
+        muxpx=-0.846574929020762,
+        muypy=0.846574929020762,
+        mutpt=0.0,
+    )
+    sim.add_particles(1.0e-9, distr, npart)
+
+    element = element_types[name](nslice)
+    sim.lattice.extend([element] * nelements)
+
+    start = time.perf_counter()
+    sim.evolve()
+    seconds = time.perf_counter() - start
+
+    pushes = npart * nelements * element.nslice
+    del sim
+    return pushes / seconds
+
+
+parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+parser.add_argument("--npart", type=int, default=100000, help="number of macro particles")
+parser.add_argument("--nelements", type=int, default=100, help="elements in the lattice")
+parser.add_argument("--nslice", type=int, default=25, help="slices per thick element")
+parser.add_argument(
+    "--elements",
+    nargs="+",
+    default=list(element_types),
+    choices=list(element_types),
+    help="element types to benchmark (default: all)",
+)
+args = parser.parse_args()
+
+results = {
+    name: benchmark(name, args.npart, args.nelements, args.nslice)
+    for name in args.elements
+}
+
+print(f"{'element':<16} {'particles/s':>14}")
+for name, rate in results.items():
+    print(f"{name:<16} {rate:14.4e}")
+
+# clean shutdown
+amrex.finalize()
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022 ImpactX contributors
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+"""Compare a beam tracked with double- and single-precision particles.
+
+Run the same input with an ImpactX build using
+ImpactX_PARTICLE_PRECISION=DOUBLE and one using SINGLE, each on one MPI
+rank in its own directory, then pass both run directories:
+
+    python3 tests/precision/compare_precision.py run_dp/ run_sp/
+
+Single-precision builds store the particle coordinates as float but push
+them in double precision. Each particle therefore picks up one float
+rounding (relative error <= 2**-24 ~= 6e-8) when its coordinates are
+stored, after sampling and after each slice. With random rounding this
+grows like the square root of the number of slices, on coordinates of up
+to a few standard deviations of the beam. We allow 1e-4 times the
+standard deviation of each coordinate in the double-precision beam, which
+covers a few hundred slices with a margin and stays far below the
+deviations of a push that computes in single precision.
+"""
+
+import argparse
+import glob
+import os
+
+import numpy as np
+import pandas as pd
+
+# per-particle tolerance, relative to the std. dev. of each coordinate
+rtol_std = 1.0e-4
+
+
+def read_all_files(file_pattern):
+    """Read in all CSV files from each MPI rank (and potentially OpenMP
+    thread). Concatenate into one Pandas dataframe.
+
+    Returns
+    -------
+    pandas.DataFrame
+    """
+    return pd.concat(
+        (
+            pd.read_csv(filename, delimiter=r"\s+")
+            for filename in glob.glob(file_pattern)
+        ),
+        axis=0,
+        ignore_index=True,
+    ).set_index("id")
+
+
+def compare(name, dp, sp):
+    """Compare each particle of two beams with the same particle ids"""
+    print(f"{name} beam:")
+    assert len(dp) > 0
+    assert dp.index.sort_values().equals(sp.index.sort_values())
+    sp = sp.loc[dp.index]
+
+    for column in ["x", "y", "t", "px", "py", "pt"]:
+        atol = rtol_std * np.std(dp[column])
+        max_diff = np.max(np.abs(sp[column] - dp[column]))
+        print(f"  {column}: max |SP - DP| = {max_diff:e} (atol={atol:e})")
+        assert np.allclose(sp[column], dp[column], rtol=0.0, atol=atol)
+
+
+parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+parser.add_argument("dp_dir", help="run directory of the double-precision build")
+parser.add_argument("sp_dir", help="run directory of the single-precision build")
+args = parser.parse_args()
+
+for name, step in [("Initial", "beam_000000"), ("Final", "beam_final")]:
+    dp = read_all_files(os.path.join(args.dp_dir, "diags", f"{step}.*"))
+    sp = read_all_files(os.path.join(args.sp_dir, "diags", f"{step}.*"))
+    compare(name, dp, sp)
@@ -77,3 +77,51 @@ def test_impactx_nofile():
     assert len(sim.lattice) > 5
 
     sim.evolve()
+
+
+def test_impactx_lattice_optics():
+    """
+    This tests the periodic lattice functions of a FODO cell, without tracking
+    """
+    import numpy as np
+
+    sim = ImpactX()
+
+    sim.set_particle_shape(2)
+    sim.init_grids()
+
+    #   reference particle
+    ref = sim.particle_container().ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_energy_MeV(2.0e3)
+
+    ns = 25  # number of slices per ds in the element
+    sim.lattice.extend(
+        [
+            elements.Drift(ds=0.25, nslice=ns),
+            elements.Quad(ds=1.0, k=1.0, nslice=ns),
+            elements.Drift(ds=0.5, nslice=ns),
+            elements.Quad(ds=1.0, k=-1.0, nslice=ns),
+            elements.Drift(ds=0.25, nslice=ns),
+        ]
+    )
+
+    optics = sim.lattice_optics()
+
+    # one entry per element and slice boundary
+    assert len(optics["s"]) == 5 * ns + 1
+    assert np.isclose(optics["s"][-1], 3.0)
+
+    # matched Twiss functions of the FODO example and its phase advance
+    assert np.isclose(optics["beta_x"][0], 2.821619407971776)
+    assert np.isclose(optics["alpha_x"][0], -1.5905003549009857)
+    assert np.isclose(optics["beta_y"][0], 2.821619407971776)
+    assert np.isclose(optics["alpha_y"][0], 1.5905003549009857)
+    assert np.isclose(optics["tune_x"], 0.188242183976104)
+    assert np.isclose(optics["tune_y"], 0.188242183976104)
+    assert np.isclose(optics["mu_x"][-1], optics["tune_x"])
+
+    # periodic, without dispersion and with linear elements only
+    assert np.isclose(optics["beta_x"][-1], optics["beta_x"][0])
+    assert np.allclose(optics["dispersion_x"], 0.0)
+    assert optics["chromaticity_x"] == 0.0
+    assert optics["one_period_map"].shape == (6, 6)